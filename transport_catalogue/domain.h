@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <variant>
+
+// тип запроса к справочнику, определяется по полю "type" один раз при разборе
+enum class RequestType {
+	STOP,
+	BUS,
+	MAP,
+	ROUTE,
+};
+
+// запрос списка автобусов через остановку
+struct StopRequest {
+	int id = 0;
+	std::string name;
+};
+
+// запрос информации о маршруте автобуса
+struct BusRequest {
+	int id = 0;
+	std::string name;
+};
+
+// запрос карты
+struct MapRequest {
+	int id = 0;
+};
+
+// запрос маршрута между двумя остановками
+struct RouteRequest {
+	int id = 0;
+	std::string from;
+	std::string to;
+};
+
+// разобранный запрос из stat_requests, порядок альтернатив совпадает с RequestType
+using StatRequest = std::variant<StopRequest, BusRequest, MapRequest, RouteRequest>;
+
+inline constexpr size_t REQUEST_TYPE_COUNT = std::variant_size_v<StatRequest>;
+
+inline RequestType GetRequestType(const StatRequest& request) {
+	return static_cast<RequestType>(request.index());
+}
+
+inline int GetRequestId(const StatRequest& request) {
+	return std::visit([](const auto& typed_request) { return typed_request.id; }, request);
+}
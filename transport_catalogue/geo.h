@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 
 struct Coordinates {
     double lat;
@@ -13,13 +15,65 @@ struct Coordinates {
     }
 };
 
-inline double ComputeDistance(Coordinates from, Coordinates to) {
-    using namespace std;
-    if (from == to) {
-        return 0;
+inline constexpr double EARTH_RADIUS = 6371000;
+inline constexpr double DEG_TO_RAD = 3.1415926535 / 180.;
+
+// синус и косинус широты, считаются один раз для точки и переиспользуются во всех расстояниях
+struct LatitudeTrig {
+    double sin_lat = 0.0;
+    double cos_lat = 1.0;
+};
+
+inline LatitudeTrig ComputeLatitudeTrig(double lat) {
+    return { std::sin(lat * DEG_TO_RAD), std::cos(lat * DEG_TO_RAD) };
+}
+
+// политики расчета расстояния между точками, выбираются параметром шаблона без диспетчеризации во время выполнения
+// каждая политика умеет считать расстояние по координатам и по координатам с заранее посчитанными LatitudeTrig
+namespace geo_distance {
+
+    // сферическая теорема косинусов - точный расчет, по нему считается кривизна маршрутов
+    struct SphericalCosines {
+        static double Distance(Coordinates from, const LatitudeTrig& from_trig, Coordinates to, const LatitudeTrig& to_trig) {
+            const double angle = std::acos(from_trig.sin_lat * to_trig.sin_lat
+                + from_trig.cos_lat * to_trig.cos_lat * std::cos(std::abs(from.lng - to.lng) * DEG_TO_RAD));
+            return from == to ? 0.0 : angle * EARTH_RADIUS;
+        }
+    };
+
+    // формула гаверсинусов - устойчивее теоремы косинусов на малых расстояниях
+    struct Haversine {
+        static double Distance(Coordinates from, const LatitudeTrig& from_trig, Coordinates to, const LatitudeTrig& to_trig) {
+            const double sin_half_lat = std::sin((to.lat - from.lat) * DEG_TO_RAD / 2);
+            const double sin_half_lng = std::sin((to.lng - from.lng) * DEG_TO_RAD / 2);
+            const double h = sin_half_lat * sin_half_lat
+                + from_trig.cos_lat * to_trig.cos_lat * sin_half_lng * sin_half_lng;
+            return 2 * EARTH_RADIUS * std::asin(std::sqrt(std::min(h, 1.0)));
+        }
+    };
+
+    // равнопромежуточная проекция - быстрое приближение для поиска ближайших остановок, границ карты и эвристик
+    // масштаб по долготе берется как среднее заранее посчитанных косинусов широт
+    struct Equirectangular {
+        static double Distance(Coordinates from, const LatitudeTrig& from_trig, Coordinates to, const LatitudeTrig& to_trig) {
+            const double x = (to.lng - from.lng) * DEG_TO_RAD * (from_trig.cos_lat + to_trig.cos_lat) / 2;
+            const double y = (to.lat - from.lat) * DEG_TO_RAD;
+            return EARTH_RADIUS * std::sqrt(x * x + y * y);
+        }
+    };
+
+    template <typename Policy>
+    double ComputeDistance(Coordinates from, Coordinates to) {
+        return Policy::Distance(from, ComputeLatitudeTrig(from.lat), to, ComputeLatitudeTrig(to.lat));
     }
-    static const double dr = 3.1415926535 / 180.;
-    return acos(sin(from.lat * dr) * sin(to.lat * dr)
-        + cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr))
-        * 6371000;
-}
\ No newline at end of file
+
+} // namespace geo_distance
+
+inline double ComputeDistance(Coordinates from, Coordinates to) {
+    return geo_distance::ComputeDistance<geo_distance::SphericalCosines>(from, to);
+}
+
+// то же, что ComputeDistance, но с уже посчитанными синусами и косинусами широт
+inline double ComputeDistance(Coordinates from, const LatitudeTrig& from_trig, Coordinates to, const LatitudeTrig& to_trig) {
+    return geo_distance::SphericalCosines::Distance(from, from_trig, to, to_trig);
+}
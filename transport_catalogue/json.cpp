@@ -1,44 +1,92 @@
 #include "json.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <utility>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 
 namespace json {
 
     namespace {
 
+        // Разбираемый текст: указатели на текущий символ и конец буфера
+        struct InputBuffer {
+            const char* pos;
+            const char* end;
+            // ресурс памяти для массивов и словарей документа
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+
+            bool AtEnd() const noexcept {
+                return pos == end;
+            }
+            // возвращает текущий символ, не сдвигая позицию, или EOF в конце буфера
+            int Peek() const noexcept {
+                return pos == end ? EOF : static_cast<unsigned char>(*pos);
+            }
+        };
+
+        bool IsSpace(char c) noexcept {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+        }
+
+        bool IsDigit(int c) noexcept {
+            return c >= '0' && c <= '9';
+        }
+
+        // Пропускает пробельные символы и считывает в c следующий символ, аналог input >> c
+        bool ReadNonSpace(InputBuffer& input, char& c) noexcept {
+            while (!input.AtEnd() && IsSpace(*input.pos)) {
+                ++input.pos;
+            }
+            if (input.AtEnd()) {
+                return false;
+            }
+            c = *input.pos++;
+            return true;
+        }
+
         //------Доп. функции для парсинга Node-------------
 
         using Number = std::variant<int, double>;
 
-        Number LoadNumber(std::istream& input) {
+        Number LoadNumber(InputBuffer& input) {
             using namespace std::literals;
 
-            std::string parsed_num;
-
-            // Считывает в parsed_num очередной символ из input
-            auto read_char = [&parsed_num, &input] {
-                parsed_num += static_cast<char>(input.get());
-                if (!input) {
-                    throw ParsingError("Failed to read number from stream"s);
-                }
-            };
+            const char* begin = input.pos;
 
-            // Считывает одну или более цифр в parsed_num из input
-            auto read_digits = [&input, read_char] {
-                if (!std::isdigit(input.peek())) {
+            // Считывает одну или более цифр
+            auto read_digits = [&input] {
+                if (!IsDigit(input.Peek())) {
                     throw ParsingError("A digit is expected"s);
                 }
-                while (std::isdigit(input.peek())) {
-                    read_char();
+                while (IsDigit(input.Peek())) {
+                    ++input.pos;
                 }
             };
 
-            if (input.peek() == '-') {
-                read_char();
+            if (input.Peek() == '-') {
+                ++input.pos;
             }
             // Парсим целую часть числа
-            if (input.peek() == '0') {
-                read_char();
+            if (input.Peek() == '0') {
+                ++input.pos;
                 // После 0 в JSON не могут идти другие цифры
             }
             else {
@@ -47,67 +95,71 @@ namespace json {
 
             bool is_int = true;
             // Парсим дробную часть числа
-            if (input.peek() == '.') {
-                read_char();
+            if (input.Peek() == '.') {
+                ++input.pos;
                 read_digits();
                 is_int = false;
             }
 
             // Парсим экспоненциальную часть числа
-            if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-                read_char();
-                if (ch = input.peek(); ch == '+' || ch == '-') {
-                    read_char();
+            if (int ch = input.Peek(); ch == 'e' || ch == 'E') {
+                ++input.pos;
+                if (ch = input.Peek(); ch == '+' || ch == '-') {
+                    ++input.pos;
                 }
                 read_digits();
                 is_int = false;
             }
 
-            try {
-                if (is_int) {
-                    // Сначала пробуем преобразовать строку в int
-                    try {
-                        return std::stoi(parsed_num);
-                    }
-                    catch (...) {
-                        // В случае неудачи, например, при переполнении,
-                        // код ниже попробует преобразовать строку в double
-                    }
+            // число разбирается прямо из буфера, без промежуточной строки и без учета локали
+            const char* end = input.pos;
+            if (is_int) {
+                // Сначала пробуем преобразовать в int, при переполнении разбираем как double
+                int int_value = 0;
+                if (auto [ptr, ec] = std::from_chars(begin, end, int_value); ec == std::errc{} && ptr == end) {
+                    return int_value;
                 }
-                return std::stod(parsed_num);
             }
-            catch (...) {
-                throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
+            double double_value = 0.0;
+            if (auto [ptr, ec] = std::from_chars(begin, end, double_value); ec == std::errc{} && ptr == end) {
+                return double_value;
             }
+            throw ParsingError("Failed to convert "s + std::string(begin, end) + " to number"s);
         }
 
         // Считывает содержимое строкового литерала JSON-документа
         // Функцию следует использовать после считывания открывающего символа ":
-        std::string ParseString(std::istream& input) {
+        std::string ParseString(InputBuffer& input) {
             using namespace std::literals;
 
-            auto it = std::istreambuf_iterator<char>(input);
-            auto end = std::istreambuf_iterator<char>();
             std::string s;
             while (true) {
-                if (it == end) {
+                // копируем целиком участок без спецсимволов
+                const char* run = input.pos;
+                while (run != input.end && *run != '"' && *run != '\\' && *run != '\n' && *run != '\r') {
+                    ++run;
+                }
+                s.append(input.pos, run);
+                input.pos = run;
+
+                if (input.AtEnd()) {
                     // Поток закончился до того, как встретили закрывающую кавычку?
                     throw ParsingError("String parsing error");
                 }
-                const char ch = *it;
+                const char ch = *input.pos;
                 if (ch == '"') {
                     // Встретили закрывающую кавычку
-                    ++it;
+                    ++input.pos;
                     break;
                 }
                 else if (ch == '\\') {
                     // Встретили начало escape-последовательности
-                    ++it;
-                    if (it == end) {
+                    ++input.pos;
+                    if (input.AtEnd()) {
                         // Поток завершился сразу после символа обратной косой черты
                         throw ParsingError("String parsing error");
                     }
-                    const char escaped_char = *(it);
+                    const char escaped_char = *input.pos;
                     // Обрабатываем одну из последовательностей: \\, \n, \t, \r, \"
                     switch (escaped_char) {
                     case 'n':
@@ -129,16 +181,12 @@ namespace json {
                         // Встретили неизвестную escape-последовательность
                         throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
                     }
+                    ++input.pos;
                 }
-                else if (ch == '\n' || ch == '\r') {
+                else {
                     // Строковый литерал внутри- JSON не может прерываться символами \r или \n
                     throw ParsingError("Unexpected end of line"s);
                 }
-                else {
-                    // Просто считываем очередной символ и помещаем его в результирующую строку
-                    s.push_back(ch);
-                }
-                ++it;
             }
 
             return s;
@@ -146,17 +194,17 @@ namespace json {
 
         // ------------------- Функции парсинга Node -------------------------
 
-        Node LoadNode(istream& input);
+        Node LoadNode(InputBuffer& input);
 
-        Node LoadArray(istream& input) {
-            Array result;
-            char c;
-            while (input >> c) {
+        Node LoadArray(InputBuffer& input) {
+            Array result(input.resource);
+            char c = 0;
+            while (ReadNonSpace(input, c)) {
                 if (c == ']') {
                     break;
                 }
                 if (c != ',') {
-                    input.putback(c);
+                    --input.pos;
                 }
                 result.push_back(LoadNode(input));
             }
@@ -167,22 +215,21 @@ namespace json {
             return Node(move(result));
         }
 
-        Node LoadDict(istream& input) {
-            Dict result;
-            char c;
-            input >> c;
+        Node LoadDict(InputBuffer& input) {
+            Dict result(input.resource);
+            char c = 0;
 
             // проверяем, если словарь пустой
-            if (c == '}') {
-                return Node(Dict{});
-            }
-            else {
-                input.putback(c);
+            if (ReadNonSpace(input, c)) {
+                if (c == '}') {
+                    return Node(move(result));
+                }
+                --input.pos;
             }
 
-            while (input >> c) {
+            while (ReadNonSpace(input, c)) {
                 // считываем ключ
-                input.putback(c);
+                --input.pos;
                 string key;
                 auto first_node = LoadNode(input);
                 if (first_node.IsString()) {
@@ -193,8 +240,7 @@ namespace json {
                 }
 
                 // считываем разделитель
-                input >> c;
-                if (c != ':') {
+                if (!ReadNonSpace(input, c) || c != ':') {
                     throw ParsingError("Failed to parse dict node");
                 }
 
@@ -202,7 +248,7 @@ namespace json {
                 result.insert({ move(key), LoadNode(input) });
 
                 // считываем следующий символ (должен быть либо "}" либо ","
-                input >> c;
+                ReadNonSpace(input, c);
                 if (c == '}') {
                     break;
                 }
@@ -220,56 +266,40 @@ namespace json {
             return Node(move(result));
         }
 
-        Node LoadString(istream& input) {
+        Node LoadString(InputBuffer& input) {
             string line = ParseString(input);
             return Node(move(line));
         }
 
-        Node LoadNull(istream& input) {
-            std::string res;
-
-            char c;
-
-            for (int i = 0; i < 4; ++i) {
-                if (input.get(c)) {
-                    res += c;
-                }
-            }
-
-            if (res != "null") {
-                throw ParsingError("Failed to parse null node");
+        // Считывает ключевое слово literal целиком, иначе выбрасывает исключение с сообщением error
+        void ReadLiteral(InputBuffer& input, std::string_view literal, const char* error) {
+            const size_t available = static_cast<size_t>(input.end - input.pos);
+            const size_t length = std::min(available, literal.size());
+            const std::string_view read(input.pos, length);
+            input.pos += length;
+            if (read != literal) {
+                throw ParsingError(error);
             }
+        }
 
+        Node LoadNull(InputBuffer& input) {
+            ReadLiteral(input, "null"sv, "Failed to parse null node");
             return Node();
         }
 
-        Node LoadBool(istream& input) {
-            std::string res;
-            char c;
-
+        Node LoadBool(InputBuffer& input) {
             //определяю сколько символов считывать
-            c = static_cast<char>(input.peek());
-            int length = c == 't' ? 4 : 5;
-
-            for (int i = 0; i < length; ++i) {
-                if (input.get(c)) {
-                    res += c;
-                }
-            }
-
-            if (res != "true"s && res != "false"s) {
-                throw ParsingError("Failed to parse bool node");
-            }
-
-            if (res == "true") {
+            if (input.Peek() == 't') {
+                ReadLiteral(input, "true"sv, "Failed to parse bool node");
                 return Node(true);
             }
             else {
+                ReadLiteral(input, "false"sv, "Failed to parse bool node");
                 return Node(false);
             }
         }
 
-        Node LoadNum(istream& input) {
+        Node LoadNum(InputBuffer& input) {
             auto num = LoadNumber(input);
             if (std::holds_alternative<double>(num)) {
                 return Node(std::get<double>(num));
@@ -279,9 +309,11 @@ namespace json {
             }
         }
 
-        Node LoadNode(istream& input) {
+        Node LoadNode(InputBuffer& input) {
             char c;
-            input >> c;
+            if (!ReadNonSpace(input, c)) {
+                throw ParsingError("Failed to parse document"s);
+            }
 
             if (c == '[') {
                 return LoadArray(input);
@@ -293,15 +325,15 @@ namespace json {
                 return LoadString(input);
             }
             else if (c == 'n') {
-                input.putback(c);
+                --input.pos;
                 return LoadNull(input);
             }
-            else if (std::isdigit(c) || c == '-') {
-                input.putback(c);
+            else if (IsDigit(static_cast<unsigned char>(c)) || c == '-') {
+                --input.pos;
                 return LoadNum(input);
             }
             else if (c == 't' || c == 'f') {
-                input.putback(c);
+                --input.pos;
                 return LoadBool(input);
             }
             else {
@@ -309,8 +341,384 @@ namespace json {
             }
         }
 
+        // ------------- Функции потокового (SAX) разбора -------------------
+
+        void ParseValue(InputBuffer& input, SaxHandler& handler);
+
+        void ParseArray(InputBuffer& input, SaxHandler& handler) {
+            handler.StartArray();
+            char c = 0;
+            while (ReadNonSpace(input, c)) {
+                if (c == ']') {
+                    break;
+                }
+                if (c != ',') {
+                    --input.pos;
+                }
+                ParseValue(input, handler);
+            }
+            // проверяем, что массив заканчивается на ]
+            if (c != ']') {
+                throw ParsingError("Failed to parse array node");
+            }
+            handler.EndArray();
+        }
+
+        void ParseDict(InputBuffer& input, SaxHandler& handler) {
+            handler.StartObject();
+            char c = 0;
+
+            // проверяем, если словарь пустой
+            if (ReadNonSpace(input, c)) {
+                if (c == '}') {
+                    handler.EndObject();
+                    return;
+                }
+                --input.pos;
+            }
+
+            while (ReadNonSpace(input, c)) {
+                // считываем ключ; не строку разбираем как обычный узел, чтобы ошибка была та же, что у Load
+                if (c != '"') {
+                    --input.pos;
+                    LoadNode(input);
+                    throw ParsingError("Failed to parse dict key");
+                }
+                handler.Key(ParseString(input));
+
+                // считываем разделитель
+                if (!ReadNonSpace(input, c) || c != ':') {
+                    throw ParsingError("Failed to parse dict node");
+                }
+
+                ParseValue(input, handler);
+
+                // считываем следующий символ (должен быть либо "}" либо ","
+                ReadNonSpace(input, c);
+                if (c == '}') {
+                    break;
+                }
+                else if (c != ',') {
+                    throw ParsingError("Failed to parse dict");
+                }
+            }
+
+            // проверяем, что если поток закончился, то последний символ был }
+            if (c != '}') {
+                throw ParsingError("Failed to parse dict node");
+            }
+            handler.EndObject();
+        }
+
+        void ParseValue(InputBuffer& input, SaxHandler& handler) {
+            char c;
+            if (!ReadNonSpace(input, c)) {
+                throw ParsingError("Failed to parse document"s);
+            }
+
+            if (c == '[') {
+                ParseArray(input, handler);
+            }
+            else if (c == '{') {
+                ParseDict(input, handler);
+            }
+            else if (c == '"') {
+                handler.String(ParseString(input));
+            }
+            else if (c == 'n') {
+                --input.pos;
+                ReadLiteral(input, "null"sv, "Failed to parse null node");
+                handler.Null();
+            }
+            else if (IsDigit(static_cast<unsigned char>(c)) || c == '-') {
+                --input.pos;
+                auto num = LoadNumber(input);
+                if (std::holds_alternative<double>(num)) {
+                    handler.Double(std::get<double>(num));
+                }
+                else {
+                    handler.Int(std::get<int>(num));
+                }
+            }
+            else if (c == 't' || c == 'f') {
+                --input.pos;
+                handler.Bool(LoadBool(input).AsBool());
+            }
+            else {
+                throw ParsingError("Failed to parse document"s);
+            }
+        }
+
+        // ------------------------ MessagePack -------------------------
+
+        // читает из буфера целое без знака из size байт в сетевом порядке (big-endian)
+        uint64_t ReadBigEndian(InputBuffer& input, size_t size) {
+            if (static_cast<size_t>(input.end - input.pos) < size) {
+                throw ParsingError("Unexpected end of MessagePack data"s);
+            }
+            uint64_t value = 0;
+            for (size_t i = 0; i < size; ++i) {
+                value = (value << 8) | static_cast<unsigned char>(input.pos[i]);
+            }
+            input.pos += size;
+            return value;
+        }
+
+        std::string_view ReadBytes(InputBuffer& input, uint64_t size) {
+            if (static_cast<uint64_t>(input.end - input.pos) < size) {
+                throw ParsingError("Unexpected end of MessagePack data"s);
+            }
+            std::string_view result(input.pos, static_cast<size_t>(size));
+            input.pos += size;
+            return result;
+        }
+
+        // целые вне диапазона int передаются как double, так же как в текстовом разборе
+        void ParseMessagePackInteger(int64_t value, SaxHandler& handler) {
+            if (value >= std::numeric_limits<int>::min() && value <= std::numeric_limits<int>::max()) {
+                handler.Int(static_cast<int>(value));
+            }
+            else {
+                handler.Double(static_cast<double>(value));
+            }
+        }
+
+        void ParseMessagePackValue(InputBuffer& input, SaxHandler& handler);
+
+        void ParseMessagePackArray(InputBuffer& input, SaxHandler& handler, uint64_t size) {
+            handler.StartArray();
+            for (uint64_t i = 0; i < size; ++i) {
+                ParseMessagePackValue(input, handler);
+            }
+            handler.EndArray();
+        }
+
+        void ParseMessagePackMap(InputBuffer& input, SaxHandler& handler, uint64_t size) {
+            handler.StartObject();
+            for (uint64_t i = 0; i < size; ++i) {
+                // ключи словаря JSON - только строки
+                if (input.AtEnd()) {
+                    throw ParsingError("Unexpected end of MessagePack data"s);
+                }
+                const unsigned char c = static_cast<unsigned char>(*input.pos++);
+                if (c >= 0xa0 && c <= 0xbf) {
+                    handler.Key(ReadBytes(input, c & 0x1f));
+                }
+                else if (c >= 0xd9 && c <= 0xdb) {
+                    handler.Key(ReadBytes(input, ReadBigEndian(input, size_t{ 1 } << (c - 0xd9))));
+                }
+                else {
+                    throw ParsingError("MessagePack map key must be a string"s);
+                }
+                ParseMessagePackValue(input, handler);
+            }
+            handler.EndObject();
+        }
+
+        void ParseMessagePackValue(InputBuffer& input, SaxHandler& handler) {
+            if (input.AtEnd()) {
+                throw ParsingError("Unexpected end of MessagePack data"s);
+            }
+            const unsigned char c = static_cast<unsigned char>(*input.pos++);
+            if (c <= 0x7f) {
+                // positive fixint
+                handler.Int(c);
+            }
+            else if (c <= 0x8f) {
+                ParseMessagePackMap(input, handler, c & 0x0f);
+            }
+            else if (c <= 0x9f) {
+                ParseMessagePackArray(input, handler, c & 0x0f);
+            }
+            else if (c <= 0xbf) {
+                handler.String(ReadBytes(input, c & 0x1f));
+            }
+            else if (c >= 0xe0) {
+                // negative fixint
+                handler.Int(static_cast<int8_t>(c));
+            }
+            else {
+                switch (c) {
+                case 0xc0:
+                    handler.Null();
+                    break;
+                case 0xc2:
+                    handler.Bool(false);
+                    break;
+                case 0xc3:
+                    handler.Bool(true);
+                    break;
+                case 0xca: {
+                    // float 32 и float 64 - IEEE 754, без разбора текста
+                    const uint32_t bits = static_cast<uint32_t>(ReadBigEndian(input, 4));
+                    float value;
+                    std::memcpy(&value, &bits, sizeof(value));
+                    handler.Double(value);
+                    break;
+                }
+                case 0xcb: {
+                    const uint64_t bits = ReadBigEndian(input, 8);
+                    double value;
+                    std::memcpy(&value, &bits, sizeof(value));
+                    handler.Double(value);
+                    break;
+                }
+                case 0xcc:
+                case 0xcd:
+                case 0xce: {
+                    const uint64_t value = ReadBigEndian(input, size_t{ 1 } << (c - 0xcc));
+                    ParseMessagePackInteger(static_cast<int64_t>(value), handler);
+                    break;
+                }
+                case 0xcf: {
+                    const uint64_t value = ReadBigEndian(input, 8);
+                    if (value > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+                        handler.Double(static_cast<double>(value));
+                    }
+                    else {
+                        ParseMessagePackInteger(static_cast<int64_t>(value), handler);
+                    }
+                    break;
+                }
+                case 0xd0:
+                    ParseMessagePackInteger(static_cast<int8_t>(ReadBigEndian(input, 1)), handler);
+                    break;
+                case 0xd1:
+                    ParseMessagePackInteger(static_cast<int16_t>(ReadBigEndian(input, 2)), handler);
+                    break;
+                case 0xd2:
+                    ParseMessagePackInteger(static_cast<int32_t>(ReadBigEndian(input, 4)), handler);
+                    break;
+                case 0xd3:
+                    ParseMessagePackInteger(static_cast<int64_t>(ReadBigEndian(input, 8)), handler);
+                    break;
+                case 0xd9:
+                case 0xda:
+                case 0xdb:
+                    handler.String(ReadBytes(input, ReadBigEndian(input, size_t{ 1 } << (c - 0xd9))));
+                    break;
+                case 0xdc:
+                case 0xdd:
+                    ParseMessagePackArray(input, handler, ReadBigEndian(input, c == 0xdc ? 2 : 4));
+                    break;
+                case 0xde:
+                case 0xdf:
+                    ParseMessagePackMap(input, handler, ReadBigEndian(input, c == 0xde ? 2 : 4));
+                    break;
+                default:
+                    // bin, ext и зарезервированный 0xc1 в схеме JSON не встречаются
+                    throw ParsingError("Unsupported MessagePack type"s);
+                }
+            }
+        }
+
+        // Считывает поток целиком большими блоками
+        std::string ReadAll(std::istream& input) {
+            constexpr size_t BLOCK_SIZE = 1 << 16;
+            std::string result;
+            size_t size = 0;
+            while (input) {
+                result.resize(size + BLOCK_SIZE);
+                input.read(result.data() + size, BLOCK_SIZE);
+                size += static_cast<size_t>(input.gcount());
+            }
+            result.resize(size);
+            return result;
+        }
+
     }  // namespace
 
+    // ------------------------- FlatDict -------------------------------
+
+    FlatDict::FlatDict(std::pmr::memory_resource* resource) : items_(resource) {
+    }
+
+    std::pair<FlatDict::iterator, bool> FlatDict::insert(value_type item) {
+        // ключи во входных данных часто уже упорядочены - тогда просто дописываем в конец
+        if (items_.empty() || items_.back().first < item.first) {
+            items_.push_back(move(item));
+            return { std::prev(items_.end()), true };
+        }
+        const size_t index = LowerBound(item.first);
+        auto it = items_.begin() + static_cast<ptrdiff_t>(index);
+        if (it != items_.end() && it->first == item.first) {
+            return { it, false };
+        }
+        return { items_.insert(it, move(item)), true };
+    }
+
+    const Node& FlatDict::at(std::string_view key) const {
+        const size_t index = IndexOf(key);
+        if (index == items_.size()) {
+            throw std::out_of_range("Key "s + std::string(key) + " not found"s);
+        }
+        return items_[index].second;
+    }
+
+    Node& FlatDict::at(std::string_view key) {
+        return const_cast<Node&>(std::as_const(*this).at(key));
+    }
+
+    FlatDict::const_iterator FlatDict::find(std::string_view key) const {
+        return items_.begin() + static_cast<ptrdiff_t>(IndexOf(key));
+    }
+
+    size_t FlatDict::count(std::string_view key) const {
+        return IndexOf(key) == items_.size() ? 0 : 1;
+    }
+
+    size_t FlatDict::size() const noexcept {
+        return items_.size();
+    }
+
+    bool FlatDict::empty() const noexcept {
+        return items_.empty();
+    }
+
+    void FlatDict::reserve(size_t size) {
+        items_.reserve(size);
+    }
+
+    FlatDict::const_iterator FlatDict::begin() const noexcept {
+        return items_.begin();
+    }
+
+    FlatDict::const_iterator FlatDict::end() const noexcept {
+        return items_.end();
+    }
+
+    bool operator==(const FlatDict& lhs, const FlatDict& rhs) {
+        return lhs.items_ == rhs.items_;
+    }
+
+    bool operator!=(const FlatDict& lhs, const FlatDict& rhs) {
+        return !(lhs == rhs);
+    }
+
+    size_t FlatDict::LowerBound(std::string_view key) const {
+        auto it = std::lower_bound(items_.begin(), items_.end(), key,
+            [](const value_type& item, std::string_view key) {
+                return std::string_view(item.first) < key;
+            });
+        return static_cast<size_t>(it - items_.begin());
+    }
+
+    size_t FlatDict::IndexOf(std::string_view key) const {
+        if (items_.size() <= LINEAR_SEARCH_SIZE) {
+            for (size_t i = 0; i < items_.size(); ++i) {
+                if (items_[i].first == key) {
+                    return i;
+                }
+            }
+            return items_.size();
+        }
+        const size_t index = LowerBound(key);
+        if (index != items_.size() && items_[index].first == key) {
+            return index;
+        }
+        return items_.size();
+    }
+
     // ------------ методы проверки на тип значения ---------------------
 
     bool Node::IsNull() const noexcept {
@@ -338,6 +746,9 @@ namespace json {
     bool Node::IsMap() const noexcept {
         return std::holds_alternative<Dict>(*this);
     }
+    bool Node::IsRaw() const noexcept {
+        return std::holds_alternative<RawJson>(*this);
+    }
 
     // -------- возврат значения определенного типа по ссылке -----------
 
@@ -398,8 +809,49 @@ namespace json {
         }
     }
 
+    const RawJson& Node::AsRaw() const {
+        if (IsRaw()) {
+            return std::get<RawJson>(*this);
+        }
+        else {
+            throw std::logic_error("Node data is not raw JSON"s);
+        }
+    }
+
     // ------------------------------------------------------------------
 
+    RawJson::RawJson(std::shared_ptr<const std::string> text) : text_(move(text)) {
+    }
+
+    RawJson::RawJson(std::shared_ptr<const std::string> text, size_t splice_pos, int splice_value)
+        : text_(move(text)), splice_pos_(splice_pos), splice_value_(splice_value) {
+        if (splice_pos_ > text_->size()) {
+            throw std::out_of_range("Splice position is out of raw JSON text"s);
+        }
+    }
+
+    const std::string& RawJson::GetText() const noexcept {
+        return *text_;
+    }
+
+    bool RawJson::HasSplice() const noexcept {
+        return splice_pos_ != NO_SPLICE;
+    }
+
+    size_t RawJson::GetSplicePos() const noexcept {
+        return splice_pos_;
+    }
+
+    int RawJson::GetSpliceValue() const noexcept {
+        return splice_value_;
+    }
+
+    RawJson RawJson::WithSpliceValue(int splice_value) const {
+        RawJson result = *this;
+        result.splice_value_ = splice_value;
+        return result;
+    }
+
     Document::Document(Node root)
         : root_(move(root)) {
     }
@@ -408,27 +860,173 @@ namespace json {
         return root_;
     }
 
-    Document Load(istream& input) {
+    Document Load(istream& input, std::pmr::memory_resource* resource) {
+        const std::string text = ReadAll(input);
+        return Load(std::string_view(text), resource);
+    }
+
+    Document Load(std::string_view text, std::pmr::memory_resource* resource) {
+        InputBuffer input{ text.data(), text.data() + text.size(), resource };
         Document result{ LoadNode(input) };
-        // проверить что после считывания в потоке не осталось лишних символов
-        if (char c; input >> c) {
+        // проверить что после считывания в буфере не осталось лишних символов
+        if (char c; ReadNonSpace(input, c)) {
             throw ParsingError("Failed to parse document"s);
         }
         return result;
     }
 
+    void Parse(std::string_view text, SaxHandler& handler) {
+        InputBuffer input{ text.data(), text.data() + text.size() };
+        ParseValue(input, handler);
+        // проверить что после считывания в буфере не осталось лишних символов
+        if (char c; ReadNonSpace(input, c)) {
+            throw ParsingError("Failed to parse document"s);
+        }
+    }
+
+    void Parse(istream& input, SaxHandler& handler) {
+        const std::string text = ReadAll(input);
+        Parse(std::string_view(text), handler);
+    }
+
+    void ParseMessagePack(std::string_view data, SaxHandler& handler) {
+        InputBuffer input{ data.data(), data.data() + data.size() };
+        ParseMessagePackValue(input, handler);
+        if (!input.AtEnd()) {
+            throw ParsingError("Trailing bytes after MessagePack document"s);
+        }
+    }
+
+    void ParseMessagePack(istream& input, SaxHandler& handler) {
+        const std::string data = ReadAll(input);
+        ParseMessagePack(std::string_view(data), handler);
+    }
+
+    // -------------------------- MappedFile ----------------------------
+
+    MappedFile::MappedFile(const std::string& path) {
+#if defined(__unix__) || defined(__APPLE__)
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open "s + path);
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0) {
+            close(fd);
+            throw std::runtime_error("Failed to stat "s + path);
+        }
+        size_ = static_cast<size_t>(file_stat.st_size);
+        // пустой файл отобразить нельзя, он разбирается как пустой буфер
+        if (size_ == 0) {
+            close(fd);
+            return;
+        }
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Failed to map "s + path);
+        }
+        // разбор читает файл один раз от начала до конца
+        madvise(data, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(data);
+        is_mapped_ = true;
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Failed to open "s + path);
+        }
+        content_ = ReadAll(file);
+        data_ = content_.data();
+        size_ = content_.size();
+#endif
+    }
+
+    MappedFile::~MappedFile() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (is_mapped_) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+#endif
+    }
+
+    std::string_view MappedFile::GetData() const noexcept {
+        return { data_, size_ };
+    }
+
+    // -------------------------- буфер вывода ----------------------------
+
+    void PrintContext::Indented() const {
+        static constexpr std::string_view SPACES = "                                ";
+        for (int rest = indent; rest > 0; rest -= static_cast<int>(SPACES.size())) {
+            out.write(SPACES.data(), std::min(rest, static_cast<int>(SPACES.size())));
+        }
+    }
+
+    OutputBuffer::OutputBuffer(std::ostream& target, size_t capacity) : target_(target), buffer_(std::max<size_t>(capacity, 1)) {
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+
+    OutputBuffer::~OutputBuffer() {
+        sync();
+    }
+
+    bool OutputBuffer::FlushBuffer() {
+        const std::streamsize size = pptr() - pbase();
+        if (size > 0 && !target_.write(pbase(), size)) {
+            return false;
+        }
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+        return true;
+    }
+
+    OutputBuffer::int_type OutputBuffer::overflow(int_type ch) {
+        if (!FlushBuffer()) {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    std::streamsize OutputBuffer::xsputn(const char* data, std::streamsize count) {
+        if (count <= epptr() - pptr()) {
+            std::copy(data, data + count, pptr());
+            pbump(static_cast<int>(count));
+            return count;
+        }
+        if (!FlushBuffer()) {
+            return 0;
+        }
+        // блок не меньше буфера копировать в него нет смысла
+        if (count >= static_cast<std::streamsize>(buffer_.size())) {
+            return target_.write(data, count) ? count : 0;
+        }
+        std::copy(data, data + count, pptr());
+        pbump(static_cast<int>(count));
+        return count;
+    }
+
+    int OutputBuffer::sync() {
+        return FlushBuffer() && target_.flush() ? 0 : -1;
+    }
+
+    BufferedOutput::BufferedOutput(std::ostream& target, size_t capacity) : std::ostream(nullptr), buffer_(target, capacity) {
+        rdbuf(&buffer_);
+    }
+
     namespace {
 
         // -------------------------- печать нод ----------------------------
 
-        void PrintNode(const Node& node, PrintContext print_context);
+        void PrintNode(const Node& node, const PrintContext& print_context);
 
-        void PrintNullNode(const Node& node, PrintContext print_context) {
-            Node a = node;
+        void PrintNullNode(const Node&, const PrintContext& print_context) {
             print_context.out << "null";
         }
 
-        void PrintBoolNode(const Node& node, PrintContext print_context) {
+        void PrintBoolNode(const Node& node, const PrintContext& print_context) {
             if (node.AsBool()) {
                 print_context.out << "true";
             }
@@ -437,48 +1035,122 @@ namespace json {
             }
         }
 
-        void PrintIntNode(const Node& node, PrintContext print_context) {
-            print_context.out << node.AsInt();
+        void PrintIntNode(const Node& node, const PrintContext& print_context) {
+            char buffer[16];
+            auto result = std::to_chars(std::begin(buffer), std::end(buffer), node.AsInt());
+            print_context.out.write(buffer, result.ptr - buffer);
         }
 
-        void PrintDoubleNode(const Node& node, PrintContext print_context) {
-            print_context.out << node.AsDouble();
+        void PrintDoubleNode(const Node& node, const PrintContext& print_context) {
+            // по умолчанию формат совпадает с operator<< для double (%g, 6 значащих цифр)
+            char buffer[32];
+            auto result = print_context.options.shortest_round_trip
+                ? std::to_chars(std::begin(buffer), std::end(buffer), node.AsDouble())
+                : std::to_chars(std::begin(buffer), std::end(buffer), node.AsDouble(), std::chars_format::general, 6);
+            print_context.out.write(buffer, result.ptr - buffer);
         }
 
-        std::string SpecialSimvilForString(const std::string& str) {
-            std::string result;
-            for (auto c : str) {
-                if (c == '\"') {
-                    result += "\\\"";
-                }
-                else if (c == '\r') {
-                    result += "\\r";
+        // Символы, которые нужно экранировать при выводе строки
+        bool IsSpecialChar(char c) noexcept {
+            return c == '"' || c == '\\' || c == '\r' || c == '\n';
+        }
+
+        // Возвращает указатель на первый символ из [begin, end), требующий экранирования, либо end
+        // блоки по 32 (AVX2) или 16 (SSE2) байт проверяются одним сравнением, остаток - посимвольно
+        const char* FindSpecialChar(const char* begin, const char* end) noexcept {
+            const char* pos = begin;
+#if defined(__AVX2__)
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i backslash = _mm256_set1_epi8('\\');
+            const __m256i cr = _mm256_set1_epi8('\r');
+            const __m256i lf = _mm256_set1_epi8('\n');
+            for (; end - pos >= 32; pos += 32) {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+                const __m256i found = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(block, cr), _mm256_cmpeq_epi8(block, lf)));
+                if (_mm256_movemask_epi8(found) != 0) {
+                    break;
                 }
-                else if (c == '\n') {
-                    result += "\\n";
+            }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+            const __m128i quote_16 = _mm_set1_epi8('"');
+            const __m128i backslash_16 = _mm_set1_epi8('\\');
+            const __m128i cr_16 = _mm_set1_epi8('\r');
+            const __m128i lf_16 = _mm_set1_epi8('\n');
+            for (; end - pos >= 16; pos += 16) {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+                const __m128i found = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(block, quote_16), _mm_cmpeq_epi8(block, backslash_16)),
+                    _mm_or_si128(_mm_cmpeq_epi8(block, cr_16), _mm_cmpeq_epi8(block, lf_16)));
+                if (_mm_movemask_epi8(found) != 0) {
+                    break;
                 }
-                else if (c == '\\') {
-                    result += "\\\\";
+            }
+#endif
+            // точное место спецсимвола внутри найденного блока и хвост строки ищем посимвольно
+            while (pos != end && !IsSpecialChar(*pos)) {
+                ++pos;
+            }
+            return pos;
+        }
+
+        // Выводит строку с экранированием, участки без спецсимволов копируются в поток целиком
+        void WriteEscapedString(std::ostream& out, std::string_view str) {
+            const char* pos = str.data();
+            const char* end = pos + str.size();
+            while (pos != end) {
+                const char* special = FindSpecialChar(pos, end);
+                out.write(pos, special - pos);
+                if (special == end) {
+                    break;
                 }
-                else {
-                    result += c;
+                switch (*special) {
+                case '"':
+                    out.write("\\\"", 2);
+                    break;
+                case '\r':
+                    out.write("\\r", 2);
+                    break;
+                case '\n':
+                    out.write("\\n", 2);
+                    break;
+                default:
+                    out.write("\\\\", 2);
+                    break;
                 }
+                pos = special + 1;
             }
-            return result;
         }
 
-        void PrintStringNode(const Node& node, PrintContext print_context) {
-            print_context.out << "\"" << SpecialSimvilForString(node.AsString()) << "\"";
+        void PrintStringNode(const Node& node, const PrintContext& print_context) {
+            PrintString(node.AsString(), print_context.out);
         }
 
-        void PrintArrayNode(const Node& node, PrintContext print_context) {
-            auto arr = node.AsArray();
+        void PrintRawNode(const Node& node, const PrintContext& print_context) {
+            const RawJson& raw = node.AsRaw();
+            const std::string& text = raw.GetText();
+            if (!raw.HasSplice()) {
+                print_context.out.write(text.data(), static_cast<std::streamsize>(text.size()));
+                return;
+            }
+            char buffer[16];
+            auto result = std::to_chars(std::begin(buffer), std::end(buffer), raw.GetSpliceValue());
+            print_context.out.write(text.data(), static_cast<std::streamsize>(raw.GetSplicePos()));
+            print_context.out.write(buffer, result.ptr - buffer);
+            print_context.out.write(text.data() + raw.GetSplicePos(), static_cast<std::streamsize>(text.size() - raw.GetSplicePos()));
+        }
+
+        void PrintArrayNode(const Node& node, const PrintContext& print_context) {
+            const Array& arr = node.AsArray();
             auto size = arr.size();
             if (size != 0) {
                 print_context.out << "[";
                 PrintNode(arr.at(0), print_context);
+                const char* separator = print_context.options.compact ? "," : ", ";
                 for (int i = 1; i < static_cast<int>(size); ++i) {
-                    print_context.out << ", ";
+                    print_context.out << separator;
                     PrintNode(arr.at(i), print_context);
                 }
                 print_context.out << "]";
@@ -488,26 +1160,38 @@ namespace json {
             }
         }
 
-        void PrintMapNode(const Node& node, PrintContext print_context) {
-            auto map = node.AsMap();
+        void PrintMapNode(const Node& node, const PrintContext& print_context) {
+            const Dict& map = node.AsMap();
             auto size = map.size();
-            if (size != 0) {
-                print_context.out << "{" << std::endl;
+            if (size != 0 && print_context.options.compact) {
+                print_context.out << "{";
+                for (auto it = map.begin(); it != map.end(); ++it) {
+                    if (it != map.begin()) {
+                        print_context.out << ",";
+                    }
+                    PrintString(it->first, print_context.out);
+                    print_context.out << ":";
+                    PrintNode(it->second, print_context);
+                }
+                print_context.out << "}";
+            }
+            else if (size != 0) {
+                print_context.out << "{\n";
 
-                PrintContext map_print_context(print_context.out, print_context.indent + 2);
+                PrintContext map_print_context(print_context.out, print_context.indent + 2, print_context.options);
                 map_print_context.Indented();
                 // вывожу первую пару вне цикла, чтобы не было лишнего переноса строки в начале или в конце
-                PrintNode(map.begin()->first, map_print_context);
+                PrintString(map.begin()->first, map_print_context.out);
                 map_print_context.out << ": ";
                 PrintNode(map.begin()->second, map_print_context);
                 for (auto it = std::next(map.begin()); it != map.end(); ++it) {
-                    map_print_context.out << "," << std::endl;
+                    map_print_context.out << ",\n";
                     map_print_context.Indented();
-                    PrintNode(it->first, map_print_context);
+                    PrintString(it->first, map_print_context.out);
                     map_print_context.out << ": ";
                     PrintNode(it->second, map_print_context);
                 }
-                print_context.out << std::endl;
+                print_context.out.put('\n');
                 print_context.Indented();
                 print_context.out << "}";
             }
@@ -516,7 +1200,7 @@ namespace json {
             }
         }
 
-        void PrintNode(const Node& node, PrintContext print_context) {
+        void PrintNode(const Node& node, const PrintContext& print_context) {
             if (node.IsNull()) {
                 PrintNullNode(node, print_context);
             }
@@ -538,10 +1222,42 @@ namespace json {
             else if (node.IsMap()) {
                 PrintMapNode(node, print_context);
             }
+            else if (node.IsRaw()) {
+                PrintRawNode(node, print_context);
+            }
         }
     }
-    void Print(const Document& doc, std::ostream& output) {
-        PrintContext print_context(output, 0);
+    void Print(const Document& doc, std::ostream& output, const PrintOptions& options) {
+        PrintContext print_context(output, 0, options);
         PrintNode(doc.GetRoot(), print_context);
     }
+
+    // единственный путь экранирования строк: им печатаются и строковые узлы, и ключи словарей
+    void PrintString(std::string_view str, std::ostream& output) {
+        output.put('"');
+        WriteEscapedString(output, str);
+        output.put('"');
+    }
+
+    // --------------------------- ArrayWriter --------------------------
+
+    ArrayWriter::ArrayWriter(std::ostream& output, const PrintOptions& options) : output_(output), options_(options) {
+        output_ << "[";
+    }
+
+    void ArrayWriter::Write(const Node& node) {
+        // разделитель как в PrintArrayNode
+        if (!is_empty_) {
+            output_ << (options_.compact ? "," : ", ");
+        }
+        is_empty_ = false;
+        PrintNode(node, PrintContext(output_, 0, options_));
+    }
+
+    void ArrayWriter::Finish() {
+        if (!is_finished_) {
+            output_ << "]";
+            is_finished_ = true;
+        }
+    }
 }  // namespace json
\ No newline at end of file
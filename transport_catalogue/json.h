@@ -1,26 +1,113 @@
 #pragma once
 
 #include <iostream>
-#include <map>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 namespace json {
     class Node;
-    // Сохраните объявления Dict и Array без изменения
-    using Dict = std::map<std::string, Node>;
-    using Array = std::vector<Node>;
 
+    // Словарь JSON: отсортированный по ключу вектор пар (ключ, значение) вместо дерева std::map
+    // пары лежат в памяти подряд, в маленьких словарях ключ ищется линейным проходом, в больших - двоичным поиском
+    // обход идет в порядке возрастания ключей, как у std::map, поэтому вывод остается отсортированным
+    // память под пары выделяется из memory_resource, переданного при создании (по умолчанию - из кучи)
+    class FlatDict {
+    public:
+        using value_type = std::pair<std::string, Node>;
+        using Items = std::pmr::vector<value_type>;
+        using iterator = Items::iterator;
+        using const_iterator = Items::const_iterator;
+
+        FlatDict() = default;
+        explicit FlatDict(std::pmr::memory_resource* resource);
+
+        // добавляет пару, если такого ключа ещё нет (как std::map::insert)
+        std::pair<iterator, bool> insert(value_type item);
+
+        // возвращает значение по ключу, если ключа нет - выбрасывает исключение std::out_of_range
+        const Node& at(std::string_view key) const;
+        Node& at(std::string_view key);
+
+        const_iterator find(std::string_view key) const;
+        size_t count(std::string_view key) const;
+
+        size_t size() const noexcept;
+        bool empty() const noexcept;
+        void reserve(size_t size);
+
+        const_iterator begin() const noexcept;
+        const_iterator end() const noexcept;
+
+        friend bool operator==(const FlatDict& lhs, const FlatDict& rhs);
+        friend bool operator!=(const FlatDict& lhs, const FlatDict& rhs);
+
+    private:
+        // до этого размера ключ ищется линейным проходом
+        static constexpr size_t LINEAR_SEARCH_SIZE = 8;
+        Items items_;
+
+        // индекс первой пары с ключом не меньше key
+        size_t LowerBound(std::string_view key) const;
+        // индекс пары с ключом key, либо size()
+        size_t IndexOf(std::string_view key) const;
+    };
+
+    using Dict = FlatDict;
+    // массив, как и словарь, может размещаться в арене (например, std::pmr::monotonic_buffer_resource)
+    // копия массива или словаря всегда размещается в ресурсе по умолчанию,
+    // а перемещенный контейнер остается в исходном ресурсе - он должен жить дольше документа
+    using Array = std::pmr::vector<Node>;
+
+    // Настройки вывода JSON
+    struct PrintOptions {
+        // печатать double кратчайшим представлением, по которому значение восстанавливается точно,
+        // вместо 6 значащих цифр по умолчанию
+        bool shortest_round_trip = false;
+        // печатать без пробелов и переносов строк, весь документ в одну строку
+        bool compact = false;
+    };
+
+    // передается по ссылке, при входе во вложенный словарь меняется только отступ
     struct PrintContext {
-        PrintContext(std::ostream& out, int indent = 0) : out(out), indent(indent) {}
-        void Indented() const {
-            for (int i = 0; i < indent; ++i) {
-                out.put(' ');
-            }
-        }
+        PrintContext(std::ostream& out, int indent = 0, PrintOptions options = {}) : out(out), indent(indent), options(options) {}
+        // выводит отступ одной записью, а не по символу
+        void Indented() const;
         std::ostream& out;
         int indent = 0;
+        PrintOptions options;
+    };
+
+    // Буфер вывода: копит данные в блоке заданного размера и передает их в целевой поток крупными кусками
+    // данные длиннее блока пишутся в целевой поток напрямую, минуя буфер
+    class OutputBuffer final : public std::streambuf {
+    public:
+        explicit OutputBuffer(std::ostream& target, size_t capacity = 1 << 20);
+        ~OutputBuffer() override;
+
+    protected:
+        int_type overflow(int_type ch) override;
+        std::streamsize xsputn(const char* data, std::streamsize count) override;
+        // передает накопленное в целевой поток и сбрасывает его
+        int sync() override;
+
+    private:
+        bool FlushBuffer();
+
+        std::ostream& target_;
+        std::vector<char> buffer_;
+    };
+
+    // Поток с OutputBuffer: flush() передает накопленные данные в целевой поток, деструктор - тоже
+    class BufferedOutput final : public std::ostream {
+    public:
+        explicit BufferedOutput(std::ostream& target, size_t capacity = 1 << 20);
+
+    private:
+        OutputBuffer buffer_;
     };
 
     // Эта ошибка должна выбрасываться при ошибках парсинга JSON
@@ -29,8 +116,43 @@ namespace json {
         using runtime_error::runtime_error;
     };
 
+    // Уже сериализованный фрагмент JSON: при печати выводится как есть, без обхода узлов и экранирования
+    // текст должен быть напечатан с теми же PrintOptions, что и документ, в который он попадет
+    // во фрагмент можно подставить одно целое число: оно выводится на место splice_pos текста -
+    // так один закэшированный ответ печатается с разными request_id
+    // текст разделяется между копиями узла, поэтому копировать закэшированный фрагмент дешево
+    // разбор JSON таких узлов не создает
+    class RawJson {
+    public:
+        explicit RawJson(std::shared_ptr<const std::string> text);
+        RawJson(std::shared_ptr<const std::string> text, size_t splice_pos, int splice_value);
+
+        const std::string& GetText() const noexcept;
+        bool HasSplice() const noexcept;
+        size_t GetSplicePos() const noexcept;
+        int GetSpliceValue() const noexcept;
+
+        // тот же фрагмент с другим подставляемым числом
+        RawJson WithSpliceValue(int splice_value) const;
+
+        friend bool operator==(const RawJson& lhs, const RawJson& rhs) {
+            return lhs.GetText() == rhs.GetText() && lhs.splice_pos_ == rhs.splice_pos_
+                && (!lhs.HasSplice() || lhs.splice_value_ == rhs.splice_value_);
+        }
+        friend bool operator!=(const RawJson& lhs, const RawJson& rhs) {
+            return !(lhs == rhs);
+        }
+
+    private:
+        static constexpr size_t NO_SPLICE = static_cast<size_t>(-1);
+
+        std::shared_ptr<const std::string> text_;
+        size_t splice_pos_ = NO_SPLICE;
+        int splice_value_ = 0;
+    };
+
     class Node final
-        : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string> {
+        : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string, RawJson> {
     public:
         using variant::variant;
         using Value = variant;
@@ -41,6 +163,7 @@ namespace json {
         const std::string& AsString() const;
         bool AsBool() const;
         double AsDouble() const;
+        const RawJson& AsRaw() const;
 
         bool IsNull() const noexcept;
         bool IsBool() const noexcept;
@@ -50,6 +173,7 @@ namespace json {
         bool IsString() const noexcept;
         bool IsArray() const noexcept;
         bool IsMap() const noexcept;
+        bool IsRaw() const noexcept;
 
         friend bool operator==(const Node& lhs, const Node& rhs) {
             return static_cast<Value>(lhs) == static_cast<Value>(rhs);
@@ -74,9 +198,85 @@ namespace json {
         Node root_;
     };
 
-    Document Load(std::istream& input);
+    // массивы и словари документа размещаются в resource, он должен жить дольше документа:
+    // с монотонной ареной весь документ освобождается разом при её уничтожении
+
+    // считывает поток целиком большими блоками и разбирает его как один документ
+    Document Load(std::istream& input, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    // разбирает документ из готового буфера
+    Document Load(std::string_view text, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Файл, отображенный в память только для чтения: разбор (Load, Parse, ParseMessagePack) идет прямо по
+    // страницам файла, без копии документа в памяти; отображение снимается при уничтожении
+    // где mmap недоступен, файл считывается в строку целиком
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& path);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        std::string_view GetData() const noexcept;
+
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+        bool is_mapped_ = false;
+        std::string content_;
+    };
+
+    // Обработчик событий потокового (SAX) разбора JSON
+    // события приходят в порядке следования в документе, ключ словаря приходит перед своим значением
+    class SaxHandler {
+    public:
+        virtual void StartObject() = 0;
+        virtual void EndObject() = 0;
+        virtual void StartArray() = 0;
+        virtual void EndArray() = 0;
+        virtual void Key(std::string_view key) = 0;
+        virtual void Null() = 0;
+        virtual void Bool(bool value) = 0;
+        virtual void Int(int value) = 0;
+        virtual void Double(double value) = 0;
+        virtual void String(std::string_view value) = 0;
+        virtual ~SaxHandler() = default;
+    };
+
+    // разбирает документ, передавая события обработчику без построения дерева Node
+    // при ошибке синтаксиса выбрасывает ParsingError (события до места ошибки уже переданы)
+    void Parse(std::string_view text, SaxHandler& handler);
+    void Parse(std::istream& input, SaxHandler& handler);
+
+    // разбирает тот же документ, закодированный в MessagePack: числа приходят готовыми IEEE 754 и целыми,
+    // строки - с длиной, поэтому текст не разбирается и не экранируется
+    // ключи словарей должны быть строками, типы bin и ext не поддерживаются (ParsingError)
+    void ParseMessagePack(std::string_view data, SaxHandler& handler);
+    void ParseMessagePack(std::istream& input, SaxHandler& handler);
+
+    void Print(const Document& doc, std::ostream& output, const PrintOptions& options = {});
 
-    void Print(const Document& doc, std::ostream& output);
+    // выводит строку в кавычках и с экранированием - так же, как строковый узел в документе
+    void PrintString(std::string_view str, std::ostream& output);
+
+    // Потоковый вывод массива верхнего уровня: каждый элемент печатается сразу при добавлении,
+    // а не после построения всего массива. Результат совпадает с Print для документа-массива
+    class ArrayWriter final {
+    public:
+        // сразу выводит открывающую скобку
+        explicit ArrayWriter(std::ostream& output, const PrintOptions& options = {});
+
+        // выводит очередной элемент массива
+        void Write(const Node& node);
+
+        // выводит закрывающую скобку, повторные вызовы ничего не делают
+        void Finish();
+
+    private:
+        std::ostream& output_;
+        PrintOptions options_;
+        bool is_empty_ = true;
+        bool is_finished_ = false;
+    };
 
 }  // namespace json
 
@@ -5,6 +5,9 @@ namespace json {
 
     using namespace std;
 
+    Builder::Builder(std::pmr::memory_resource* resource) : resource_(resource) {
+    }
+
     const Node& Builder::Build() const {
         // Если строитель пустой или есть незакрытые контейнеры
         if (is_empty_ || !nodes_stack_.empty()) {
@@ -23,36 +26,46 @@ namespace json {
         throw std::logic_error("Incorrect Key");
     }
 
-    Builder& Builder::Value(Node::Value value) {
+    Node Builder::Extract() {
+        Build();
+        Node result = std::move(root_);
+        root_ = Node{};
+        is_empty_ = true;
+        return result;
+    }
 
-        Node new_node = std::visit([](auto val) {return Node(val);}, value);
+    Builder& Builder::Value(Node value) {
+        Emplace(std::move(value));
+        return *this;
+    }
 
+    Node* Builder::Emplace(Node value) {
         // Если класс еще пустой
         if (is_empty_) {
-            root_ = new_node;
+            root_ = std::move(value);
             is_empty_ = false;
-            return *this;
+            return &root_;
         }
 
         // Если внутри словаря и ключ уже добавлен
         if (!nodes_stack_.empty() && nodes_stack_.back()->IsMap() && has_key_) {
-            const_cast<Dict&>(nodes_stack_.back()->AsMap()).insert({ key_, new_node });
+            auto [it, inserted] = const_cast<Dict&>(nodes_stack_.back()->AsMap()).insert({ std::move(key_), std::move(value) });
             has_key_ = false;
-            return *this;
+            return const_cast<Node*>(&it->second);
         }
 
         // Если внутри массива
         if (!nodes_stack_.empty() && nodes_stack_.back()->IsArray()) {
-            const_cast<Array&>(nodes_stack_.back()->AsArray()).push_back(new_node);
-            return *this;
+            auto& array = const_cast<Array&>(nodes_stack_.back()->AsArray());
+            array.push_back(std::move(value));
+            return &array.back();
         }
 
         throw std::logic_error("Incorrect Value");
     }
 
     Builder::DictItemContext Builder::StartDict() {
-        Value(Dict{});
-        AddRef(Node(Dict{}));
+        nodes_stack_.push_back(Emplace(Dict(resource_)));
         return DictItemContext(*this);
     }
 
@@ -66,8 +79,7 @@ namespace json {
     }
 
     Builder::ArrayItemContext Builder::StartArray() {
-        Value(Array{});
-        AddRef(Node(Array{}));
+        nodes_stack_.push_back(Emplace(Array(resource_)));
         return ArrayItemContext(*this);
     }
 
@@ -80,36 +92,13 @@ namespace json {
         throw std::logic_error("Incorrect EndArray");
     }
 
-    void Builder::AddRef(const Node& value) {
-        // если value - Array или Map, нужно добавить указатель на новую структуру в стек nodes_stack_
-        if (value.IsArray() || value.IsMap()) {
-            // если вне структуры
-            if (nodes_stack_.empty()) {
-                nodes_stack_.push_back(&root_);
-                return;
-            }
-            // если массив
-            if (nodes_stack_.back()->IsArray()) {
-                auto p = &nodes_stack_.back()->AsArray().back();
-                nodes_stack_.push_back(const_cast<Node*>(p));
-                return;
-            }
-            // если словарь
-            if (nodes_stack_.back()->IsMap()) {
-                auto p = &nodes_stack_.back()->AsMap().at(key_);
-                nodes_stack_.push_back(const_cast<Node*>(p));
-                return;
-            }
-        }
-    }
-
     //Реализация дополнительных классов
-    Builder::DictItemContext Builder::KeyItemContext::Value(Node::Value value) {
+    Builder::DictItemContext Builder::KeyItemContext::Value(Node value) {
         builder_.Value(std::move(value));
         return DictItemContext{ builder_ };
     }
 
-    Builder::ArrayItemContext Builder::ArrayItemContext::Value(Node::Value value) {
+    Builder::ArrayItemContext Builder::ArrayItemContext::Value(Node value) {
         builder_.Value(std::move(value));
         return ArrayItemContext{ builder_ };
     }
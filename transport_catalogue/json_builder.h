@@ -13,12 +13,18 @@ namespace json {
 
     public:
         Builder() = default;
+        // массивы и словари, открытые через StartArray/StartDict, размещаются в resource
+        explicit Builder(std::pmr::memory_resource* resource);
 
         // выбрасывает исключение std::logic_error если на момент вызова объект некорректен
         const Node& Build() const;
+        // перемещает построенный узел из строителя без копирования, строитель становится пустым
+        // выбрасывает исключение std::logic_error если на момент вызова объект некорректен
+        Node Extract();
 
         KeyItemContext Key(std::string key);
-        Builder& Value(Node::Value value);
+        // значение перемещается в родительский контейнер; чтобы не копировать массив или словарь, передавайте rvalue
+        Builder& Value(Node value);
 
         DictItemContext StartDict();
         Builder& EndDict();
@@ -27,6 +33,7 @@ namespace json {
         Builder& EndArray();
 
     private:
+        std::pmr::memory_resource* resource_ = std::pmr::get_default_resource();
         Node root_;
         std::vector<Node*> nodes_stack_;
         // состояние по умолчанию при создании словаря
@@ -34,8 +41,9 @@ namespace json {
         // наличие введенного ключа
         bool has_key_ = false;
         std::string key_;
-        // добавляет указатель на новый узел в nodes_stack_ в зависимости от типа value
-        void AddRef(const Node& value);
+        // размещает узел в корне, в открытом словаре по ключу key_ или в открытом массиве
+        // возвращает указатель на размещенный узел
+        Node* Emplace(Node value);
     };
 
     // ---- Вспомогательные классы для проверки корректности времени компиляции ----
@@ -63,7 +71,7 @@ namespace json {
     class Builder::KeyItemContext final : public ItemContext {
     public:
         using ItemContext::ItemContext;
-        DictItemContext Value(Node::Value value);
+        DictItemContext Value(Node value);
         using ItemContext::StartDict;
         using ItemContext::StartArray;
     };
@@ -71,7 +79,7 @@ namespace json {
     class Builder::ArrayItemContext final : public ItemContext {
     public:
         using ItemContext::ItemContext;
-        ArrayItemContext Value(Node::Value value);
+        ArrayItemContext Value(Node value);
         using ItemContext::StartDict;
         using ItemContext::StartArray;
         using ItemContext::EndArray;
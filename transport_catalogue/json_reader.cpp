@@ -1,4 +1,394 @@
 #include "json_reader.h"
+#include "stats.h"
+
+#include <algorithm>
+
+namespace {
+
+    // Обработчик потокового разбора: запросы из base_requests сразу попадают в каталог,
+    // остальные разделы корневого словаря собираются в json::Node через json::Builder
+    class BaseRequestsLoader final : public json::SaxHandler {
+    public:
+        BaseRequestsLoader(transport_catalogue::TransportCatalogue& catalogue, std::pmr::memory_resource* resource)
+            : catalogue_(catalogue), resource_(resource), sections_(resource) {}
+
+        void StartObject() override {
+            OnDistanceValue(false);
+            ++depth_;
+            if (builder_) {
+                builder_->StartDict();
+            }
+            else if (in_base_ && depth_ == REQUEST_DEPTH) {
+                request_ = BaseRequest{};
+            }
+            else if (!in_base_ && depth_ == SECTION_DEPTH + 1) {
+                StartSection().StartDict();
+            }
+        }
+
+        void EndObject() override {
+            --depth_;
+            if (builder_) {
+                builder_->EndDict();
+                FinishSection();
+            }
+            else if (in_base_ && depth_ == REQUEST_DEPTH - 1) {
+                AddRequest();
+            }
+        }
+
+        void StartArray() override {
+            OnDistanceValue(false);
+            ++depth_;
+            if (builder_) {
+                builder_->StartArray();
+            }
+            else if (depth_ == SECTION_DEPTH + 1) {
+                if (section_ == "base_requests") {
+                    in_base_ = true;
+                    has_base_ = true;
+                }
+                else {
+                    StartSection().StartArray();
+                }
+            }
+        }
+
+        void EndArray() override {
+            --depth_;
+            if (builder_) {
+                builder_->EndArray();
+                FinishSection();
+            }
+            else if (in_base_ && depth_ == SECTION_DEPTH) {
+                in_base_ = false;
+                FlushDeferred();
+            }
+        }
+
+        void Key(std::string_view key) override {
+            if (builder_) {
+                builder_->Key(std::string(key));
+            }
+            else if (depth_ == SECTION_DEPTH) {
+                section_ = key;
+            }
+            else if (in_base_ && depth_ == REQUEST_DEPTH) {
+                field_ = key;
+            }
+            else if (in_base_ && depth_ == REQUEST_DEPTH + 1 && field_ == "road_distances") {
+                distance_to_ = key;
+            }
+        }
+
+        // узлы строятся только для значений вне base_requests, поля базовых запросов читаются сразу
+        void Null() override {
+            if (IsSectionValue()) {
+                OnValue(nullptr);
+                return;
+            }
+            OnDistanceValue(false);
+        }
+        void Bool(bool value) override {
+            if (IsSectionValue()) {
+                OnValue(value);
+                return;
+            }
+            OnDistanceValue(false);
+            if (IsRequestField("is_roundtrip")) {
+                request_.is_roundtrip = value;
+            }
+        }
+        void Int(int value) override {
+            if (IsSectionValue()) {
+                OnValue(value);
+                return;
+            }
+            OnNumber(value);
+            if (OnDistanceValue(true)) {
+                request_.road_distances.push_back({ std::move(distance_to_), value });
+            }
+        }
+        void Double(double value) override {
+            if (IsSectionValue()) {
+                OnValue(value);
+                return;
+            }
+            OnNumber(value);
+            OnDistanceValue(false);
+        }
+        void String(std::string_view value) override {
+            if (IsSectionValue()) {
+                OnValue(std::string(value));
+                return;
+            }
+            OnDistanceValue(false);
+            if (IsRequestField("type")) {
+                request_.type = value;
+            }
+            else if (IsRequestField("name")) {
+                request_.name = value;
+            }
+            else if (in_base_ && depth_ == REQUEST_DEPTH + 1 && field_ == "stops") {
+                request_.stops.emplace_back(value);
+            }
+        }
+
+        // возвращает документ из всех разделов, кроме base_requests
+        // документ без массива base_requests - ошибка: пустая база должна быть задана пустым массивом
+        json::Document GetDocument() {
+            if (!has_base_) {
+                throw std::out_of_range("Document has no base_requests array"s);
+            }
+            return json::Document{ json::Node(std::move(sections_)) };
+        }
+
+    private:
+        // глубина вложенности, на которой лежат разделы корневого словаря и отдельные базовые запросы
+        static constexpr int SECTION_DEPTH = 1;
+        static constexpr int REQUEST_DEPTH = 3;
+
+        // поля одного базового запроса
+        struct BaseRequest {
+            std::string type;
+            std::string name;
+            std::optional<double> latitude;
+            std::optional<double> longitude;
+            std::vector<std::pair<std::string, int>> road_distances;
+            // первая остановка, расстояние до которой задано не целым числом
+            std::optional<std::string> non_integer_distance_to;
+            std::vector<std::string> stops;
+            std::optional<bool> is_roundtrip;
+        };
+
+        struct DeferredDistance {
+            std::string from;
+            std::string to;
+            int distance = 0;
+        };
+
+        struct DeferredRoute {
+            std::string name;
+            RouteType route_type = RouteType::UNKNOWN;
+            std::vector<std::string> stops;
+        };
+
+        transport_catalogue::TransportCatalogue& catalogue_;
+        std::pmr::memory_resource* resource_;
+        int depth_ = 0;
+        std::string section_;
+        bool in_base_ = false;
+        bool has_base_ = false;
+        std::string field_;
+        std::string distance_to_;
+        BaseRequest request_;
+
+        // расстояния и маршруты ссылаются на остановки, которые могут идти в документе позже
+        std::vector<DeferredDistance> deferred_distances_;
+        std::vector<DeferredRoute> deferred_routes_;
+
+        std::optional<json::Builder> builder_;
+        json::Dict sections_;
+
+        // значение лежит в разделе, который собирается узлом json::Node
+        bool IsSectionValue() const {
+            return builder_ || depth_ == SECTION_DEPTH;
+        }
+
+        // отмечает значение расстояния в road_distances; расстояние, как и при загрузке документа целиком, должно быть целым
+        // возвращает, было ли значение расстоянием
+        bool OnDistanceValue(bool is_integer) {
+            if (!in_base_ || depth_ != REQUEST_DEPTH + 1 || field_ != "road_distances") {
+                return false;
+            }
+            if (!is_integer && !request_.non_integer_distance_to) {
+                request_.non_integer_distance_to = distance_to_;
+            }
+            return true;
+        }
+
+        bool IsRequestField(std::string_view field) const {
+            return !builder_ && in_base_ && depth_ == REQUEST_DEPTH && field_ == field;
+        }
+
+        void OnNumber(double value) {
+            if (IsRequestField("latitude")) {
+                request_.latitude = value;
+            }
+            else if (IsRequestField("longitude")) {
+                request_.longitude = value;
+            }
+        }
+
+        void OnValue(json::Node value) {
+            if (builder_) {
+                builder_->Value(std::move(value));
+                FinishSection();
+            }
+            else if (depth_ == SECTION_DEPTH) {
+                StartSection().Value(std::move(value));
+                FinishSection();
+            }
+        }
+
+        json::Builder& StartSection() {
+            builder_.emplace(resource_);
+            return *builder_;
+        }
+
+        // если значение раздела собрано целиком - сохраняем его
+        void FinishSection() {
+            if (builder_ && depth_ == SECTION_DEPTH) {
+                sections_.insert({ section_, builder_->Extract() });
+                builder_.reset();
+            }
+        }
+
+        void AddRequest() {
+            if (request_.type == "Stop") {
+                if (!request_.latitude || !request_.longitude) {
+                    throw std::out_of_range("Stop "s + request_.name + " has no coordinates"s);
+                }
+                if (request_.non_integer_distance_to) {
+                    throw std::invalid_argument("Stop "s + request_.name + " has a non-integer road distance to "s
+                        + *request_.non_integer_distance_to);
+                }
+                CheckUniqueDistances();
+                catalogue_.AddStop(request_.name, { *request_.latitude, *request_.longitude });
+                for (auto& [stop_to, distance] : request_.road_distances) {
+                    deferred_distances_.push_back({ request_.name, std::move(stop_to), distance });
+                }
+            }
+            else if (request_.type == "Bus") {
+                if (!request_.is_roundtrip) {
+                    throw std::out_of_range("Bus "s + request_.name + " has no is_roundtrip"s);
+                }
+                deferred_routes_.push_back({ std::move(request_.name),
+                    *request_.is_roundtrip ? RouteType::CIRCLE : RouteType::LINEAR, std::move(request_.stops) });
+            }
+        }
+
+        // повторный ключ в road_distances остановки - ошибка, а не молчаливая замена расстояния
+        void CheckUniqueDistances() const {
+            std::vector<std::string_view> stops_to;
+            stops_to.reserve(request_.road_distances.size());
+            for (const auto& [stop_to, distance] : request_.road_distances) {
+                stops_to.push_back(stop_to);
+            }
+            std::sort(stops_to.begin(), stops_to.end());
+            const auto duplicate = std::adjacent_find(stops_to.begin(), stops_to.end());
+            if (duplicate != stops_to.end()) {
+                throw std::invalid_argument("Stop "s + request_.name + " has several road distances to "s + std::string(*duplicate));
+            }
+        }
+
+        // все остановки уже в каталоге - добавляем расстояния и маршруты в порядке документа
+        void FlushDeferred() {
+            for (const auto& distance : deferred_distances_) {
+                catalogue_.SetDistance(distance.from, distance.to, distance.distance);
+            }
+            for (const auto& route : deferred_routes_) {
+                catalogue_.AddRoute(route.name, route.route_type, route.stops);
+            }
+            deferred_distances_.clear();
+            deferred_distances_.shrink_to_fit();
+            deferred_routes_.clear();
+            deferred_routes_.shrink_to_fit();
+        }
+    };
+
+    // ключи запроса из stat_requests
+    enum class RequestField {
+        ID,
+        TYPE,
+        NAME,
+        FROM,
+        TO,
+        UNKNOWN,
+    };
+
+    // таблицы разбора строится на этапе компиляции, строки сравниваются один раз на каждый ключ
+    constexpr std::pair<std::string_view, RequestField> REQUEST_FIELDS[] = {
+        { "id"sv, RequestField::ID },
+        { "type"sv, RequestField::TYPE },
+        { "name"sv, RequestField::NAME },
+        { "from"sv, RequestField::FROM },
+        { "to"sv, RequestField::TO },
+    };
+
+    constexpr std::pair<std::string_view, RequestType> REQUEST_TYPES[] = {
+        { "Stop"sv, RequestType::STOP },
+        { "Bus"sv, RequestType::BUS },
+        { "Map"sv, RequestType::MAP },
+        { "Route"sv, RequestType::ROUTE },
+    };
+
+    template <typename Enum, size_t N>
+    std::optional<Enum> FindInTable(const std::pair<std::string_view, Enum>(&table)[N], std::string_view key) {
+        for (const auto& [name, value] : table) {
+            if (name == key) {
+                return value;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // раскладывает запрос в типизированную структуру за один проход по его полям
+    // если тип запроса неизвестен - возвращает nullopt, если нет обязательного поля - выбрасывает std::out_of_range
+    std::optional<StatRequest> DecodeStatRequest(const json::Node& node) {
+        const json::Node* id = nullptr;
+        const json::Node* type = nullptr;
+        const json::Node* name = nullptr;
+        const json::Node* from = nullptr;
+        const json::Node* to = nullptr;
+        for (const auto& [key, value] : node.AsMap()) {
+            switch (FindInTable(REQUEST_FIELDS, key).value_or(RequestField::UNKNOWN)) {
+            case RequestField::ID:
+                id = &value;
+                break;
+            case RequestField::TYPE:
+                type = &value;
+                break;
+            case RequestField::NAME:
+                name = &value;
+                break;
+            case RequestField::FROM:
+                from = &value;
+                break;
+            case RequestField::TO:
+                to = &value;
+                break;
+            case RequestField::UNKNOWN:
+                break;
+            }
+        }
+
+        auto required = [](const json::Node* field, std::string_view field_name) -> const json::Node& {
+            if (field == nullptr) {
+                throw std::out_of_range("Request has no field "s + std::string(field_name));
+            }
+            return *field;
+        };
+
+        auto request_type = FindInTable(REQUEST_TYPES, required(type, "type"sv).AsString());
+        if (!request_type) {
+            return std::nullopt;
+        }
+        const int request_id = required(id, "id"sv).AsInt();
+        switch (*request_type) {
+        case RequestType::STOP:
+            return StopRequest{ request_id, required(name, "name"sv).AsString() };
+        case RequestType::BUS:
+            return BusRequest{ request_id, required(name, "name"sv).AsString() };
+        case RequestType::MAP:
+            return MapRequest{ request_id };
+        case RequestType::ROUTE:
+            return RouteRequest{ request_id, required(from, "from"sv).AsString(), required(to, "to"sv).AsString() };
+        }
+        return std::nullopt;
+    }
+
+} // namespace
 
 
 
@@ -10,21 +400,63 @@ json::Document JsonReader::ReadJsonInformation() {
 }
 
 
-std::vector<json::Node> JsonReader::ReadStatRequests(json::Document& doc_inf) {
-    std::vector<json::Node> stat_requests;
-    for (auto& node_inf : *(&(&(doc_inf.GetRoot().AsMap()))->at("stat_requests").AsArray())) {
-        stat_requests.push_back(node_inf);
+json::Document JsonReader::ReadJsonStreaming(transport_catalogue::TransportCatalogue& catalogue, std::istream& input,
+    std::pmr::memory_resource* resource) const {
+    [[maybe_unused]] stats::ScopedTimer timer(stats::Phase::LOAD_BASE);
+    BaseRequestsLoader loader(catalogue, resource);
+    json::Parse(input, loader);
+    return loader.GetDocument();
+}
+
+json::Document JsonReader::ReadJsonStreaming(transport_catalogue::TransportCatalogue& catalogue, std::string_view text,
+    std::pmr::memory_resource* resource) const {
+    [[maybe_unused]] stats::ScopedTimer timer(stats::Phase::LOAD_BASE);
+    BaseRequestsLoader loader(catalogue, resource);
+    json::Parse(text, loader);
+    return loader.GetDocument();
+}
+
+json::Document JsonReader::ReadMessagePackStreaming(transport_catalogue::TransportCatalogue& catalogue, std::istream& input,
+    std::pmr::memory_resource* resource) const {
+    [[maybe_unused]] stats::ScopedTimer timer(stats::Phase::LOAD_BASE);
+    BaseRequestsLoader loader(catalogue, resource);
+    json::ParseMessagePack(input, loader);
+    return loader.GetDocument();
+}
+
+json::Document JsonReader::ReadMessagePackStreaming(transport_catalogue::TransportCatalogue& catalogue, std::string_view data,
+    std::pmr::memory_resource* resource) const {
+    [[maybe_unused]] stats::ScopedTimer timer(stats::Phase::LOAD_BASE);
+    BaseRequestsLoader loader(catalogue, resource);
+    json::ParseMessagePack(data, loader);
+    return loader.GetDocument();
+}
+
+std::vector<StatRequest> JsonReader::ReadStatRequests(const json::Document& doc_inf) const {
+    [[maybe_unused]] stats::ScopedTimer timer(stats::Phase::READ_STAT_REQUESTS);
+    const json::Array& requests = doc_inf.GetRoot().AsMap().at("stat_requests").AsArray();
+    std::vector<StatRequest> stat_requests;
+    stat_requests.reserve(requests.size());
+    for (const auto& node_inf : requests) {
+        // запросы неизвестного типа пропускаются
+        if (auto request = DecodeStatRequest(node_inf)) {
+            stat_requests.push_back(std::move(*request));
+        }
     }
     return stat_requests;
 }
 
+std::optional<StatRequest> JsonReader::ReadStatRequest(const json::Node& request) const {
+    return DecodeStatRequest(request);
+}
+
 //отвечает за скорость автобуса и ожидания на остановке
-std::pair<int, int> JsonReader::ReadRoutingSettings(json::Document& doc_inf) {
-    std::map<std::string, json::Node> routing_settings = (&(doc_inf.GetRoot().AsMap()))->at("routing_settings").AsMap();
-    int time = routing_settings.at("bus_wait_time").AsInt();
-    int speed= routing_settings.at("bus_velocity").AsInt();
-    std::pair<int, int> a = std::make_pair( time, speed );
-    return a;
+transport_router::TransportRouter::RoutingSettings JsonReader::ReadRoutingSettings(const json::Document& doc_inf) const {
+    const json::Dict& routing_settings = doc_inf.GetRoot().AsMap().at("routing_settings").AsMap();
+    transport_router::TransportRouter::RoutingSettings settings;
+    settings.wait_time = routing_settings.at("bus_wait_time").AsInt();
+    settings.velocity = routing_settings.at("bus_velocity").AsDouble() * transport_router::KMH_TO_MMIN;
+    return settings;
 }
 
 
@@ -88,9 +520,9 @@ void JsonReader::AddBusAndRouts(transport_catalogue::TransportCatalogue& catalog
     }
 }
 
-RenderSettings JsonReader::ReadRenderSettings(json::Document& doc_inf) const {
+RenderSettings JsonReader::ReadRenderSettings(const json::Document& doc_inf) const {
     RenderSettings render_settings;
-    std::map<std::string, json::Node> json_settings = (&(doc_inf.GetRoot().AsMap()))->at("render_settings").AsMap();
+    const json::Dict& json_settings = doc_inf.GetRoot().AsMap().at("render_settings").AsMap();
 
     double width = json_settings.at("width").AsDouble();
     double height = json_settings.at("height").AsDouble();
@@ -6,17 +6,38 @@
 //#include "json.h"
 #include "json_builder.h"
 #include "map_renderer.h"
+#include "transport_router.h"
+#include "domain.h"
 
 class JsonReader final {
 public:
     //считывает поток данных
     json::Document ReadJsonInformation();
 
-    //отвечает на запросы
-    std::vector<json::Node> ReadStatRequests(json::Document& doc_inf);
+    //считывает поток данных потоковым разбором, добавляя базовые запросы в каталог по мере их появления
+    //для base_requests дерево json::Node не строится, ссылки на ещё не добавленные остановки откладываются до конца раздела
+    //возвращает документ с остальными разделами (настройки, stat_requests), его массивы и словари размещаются в resource
+    json::Document ReadJsonStreaming(transport_catalogue::TransportCatalogue& catalogue, std::istream& input = std::cin,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
 
-    //отвечает за скорость автобуса и ожидания на остановке
-    std::pair<int, int> ReadRoutingSettings(json::Document& doc_inf);
+    //то же по готовому буферу, например по файлу, отображенному в память (json::MappedFile)
+    json::Document ReadJsonStreaming(transport_catalogue::TransportCatalogue& catalogue, std::string_view text,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+    //то же для документа той же схемы, закодированного в MessagePack
+    json::Document ReadMessagePackStreaming(transport_catalogue::TransportCatalogue& catalogue, std::istream& input,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+    json::Document ReadMessagePackStreaming(transport_catalogue::TransportCatalogue& catalogue, std::string_view data,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+    //раскладывает stat_requests в типизированные запросы, запросы неизвестного типа пропускаются
+    std::vector<StatRequest> ReadStatRequests(const json::Document& doc_inf) const;
+
+    //раскладывает один запрос в типизированную структуру, для запроса неизвестного типа возвращает nullopt
+    std::optional<StatRequest> ReadStatRequest(const json::Node& request) const;
+
+    //отвечает за скорость автобуса и ожидания на остановке, скорость переводится в м/мин
+    transport_router::TransportRouter::RoutingSettings ReadRoutingSettings(const json::Document& doc_inf) const;
 
     //считывает всю инофрмацию о автобусах, маршрутах и остановках
     void ReadBaseRequests(transport_catalogue::TransportCatalogue& catalogue, json::Document& doc_inf);
@@ -28,7 +49,7 @@ public:
     void AddBusAndRouts(transport_catalogue::TransportCatalogue& catalogue, json::Document& doc_inf) const;
 
     //считывает настройки рендера карты
-    RenderSettings ReadRenderSettings(json::Document& doc_inf) const;
+    RenderSettings ReadRenderSettings(const json::Document& doc_inf) const;
 
     //проверяет на цвет
     svg::Color DefineColor(const json::Node& color_type) const;
@@ -2,22 +2,211 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <charconv>
+#include <optional>
 #include "request_handler.h"
 #include "map_renderer.h"
+#include "query_server.h"
+#include "stats.h"
 
 
 
-void TestAll2() {
+// настройки запуска, задаются ключами командной строки
+struct OutputSettings {
+    // --msgpack: входной документ закодирован в MessagePack, а не в JSON
+    bool msgpack = false;
+    // --compact: ответы без пробелов и переносов строк
+    bool compact = false;
+    // --buffered: вывод копится в большом буфере и отдается в stdout крупными блоками
+    bool buffered = false;
+    // --stats <file>: куда вывести статистику времени работы ("-" - в stderr); выводится в конце работы,
+    // а сервером - ещё и по сигналу SIGUSR1. Статистика собирается при сборке с -DTRANSPORT_CATALOGUE_STATS
+    std::string stats_path;
+};
+
+void WriteStats(const std::string& stats_path) {
+    if (stats_path == "-"s) {
+        stats::WriteJson(std::cerr);
+        return;
+    }
+    std::ofstream output(stats_path);
+    if (!output) {
+        throw std::runtime_error("Failed to open "s + stats_path);
+    }
+    stats::WriteJson(output);
+}
+
+json::Document ReadBase(const JsonReader& json_inf, transport_catalogue::TransportCatalogue& catalogue, std::istream& input,
+    std::pmr::memory_resource* resource, const OutputSettings& output_settings) {
+    return output_settings.msgpack
+        ? json_inf.ReadMessagePackStreaming(catalogue, input, resource)
+        : json_inf.ReadJsonStreaming(catalogue, input, resource);
+}
+
+// базовые данные из файла разбираются прямо по его отображению в память, без копии документа;
+// отображение снимается сразу после загрузки
+json::Document ReadBaseFile(const JsonReader& json_inf, transport_catalogue::TransportCatalogue& catalogue, const std::string& path,
+    std::pmr::memory_resource* resource, const OutputSettings& output_settings) {
+    const json::MappedFile file(path);
+    return output_settings.msgpack
+        ? json_inf.ReadMessagePackStreaming(catalogue, file.GetData(), resource)
+        : json_inf.ReadJsonStreaming(catalogue, file.GetData(), resource);
+}
+
+void TestAll2(const OutputSettings& output_settings) {
+    JsonReader json_inf;
+    transport_catalogue::TransportCatalogue catalogue;
+    // разделы документа живут в арене и освобождаются разом в конце работы
+    std::pmr::monotonic_buffer_resource document_arena;
+    json::Document a = ReadBase(json_inf, catalogue, std::cin, &document_arena, output_settings);
+
+    RequestHandler request_handler(catalogue, json_inf.ReadRenderSettings(a), json_inf.ReadRoutingSettings(a));
+    json::PrintOptions options;
+    options.compact = output_settings.compact;
+    if (output_settings.buffered) {
+        json::BufferedOutput output(std::cout);
+        request_handler.OutputStatRequests(json_inf.ReadStatRequests(a), output, options);
+    }
+    else {
+        request_handler.OutputStatRequests(json_inf.ReadStatRequests(a), std::cout, options);
+    }
+}
+
+// режим NDJSON: базовые данные загружаются один раз из файла, затем запросы читаются из stdin построчно
+void ServeNdjson(const std::string& base_path, const OutputSettings& output_settings) {
+    JsonReader json_inf;
+    transport_catalogue::TransportCatalogue catalogue;
+    std::pmr::monotonic_buffer_resource document_arena;
+    json::Document a = ReadBaseFile(json_inf, catalogue, base_path, &document_arena, output_settings);
+    // поток запросов не ограничен, и одни и те же остановки и автобусы спрашивают многократно - ответы стоит хранить
+    RequestHandler request_handler(catalogue, json_inf.ReadRenderSettings(a), json_inf.ReadRoutingSettings(a), true);
+    if (output_settings.buffered) {
+        json::BufferedOutput output(std::cout);
+        request_handler.ServeNdjson(std::cin, output);
+    }
+    else {
+        request_handler.ServeNdjson(std::cin, std::cout);
+    }
+}
+
+// режим сервера: базовые данные загружаются один раз, запросы принимаются через Unix domain socket
+void RunServer(const std::string& base_path, query_server::ServerSettings server_settings, const OutputSettings& output_settings) {
     JsonReader json_inf;
-    json::Document a = json_inf.ReadJsonInformation();
     transport_catalogue::TransportCatalogue catalogue;
-    json_inf.ReadBaseRequests(catalogue, a);
-    OutputStatRequests(catalogue, json_inf.ReadStatRequests(a), json_inf.ReadRenderSettings(a), json_inf.ReadRoutingSettings(a));
+    std::pmr::monotonic_buffer_resource document_arena;
+    json::Document a = ReadBaseFile(json_inf, catalogue, base_path, &document_arena, output_settings);
+    RequestHandler request_handler(catalogue, json_inf.ReadRenderSettings(a), json_inf.ReadRoutingSettings(a), true);
+    query_server::QueryServer server(request_handler, std::move(server_settings));
+    server.Run();
+}
+
+// число потоков-обработчиков сервера: целое больше нуля, иначе nullopt
+std::optional<size_t> ParseWorkerCount(std::string_view text) {
+    size_t count = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), count);
+    if (error != std::errc{} || end != text.data() + text.size() || count == 0) {
+        return std::nullopt;
+    }
+    return count;
+}
+
+void PrintUsage(const char* program) {
+    std::cerr << "Usage: "sv << program << " [--msgpack] [--compact] [--buffered] [--ndjson <base>]"sv
+        << " [--server <socket> <base> [--workers <count>]] [--client <socket>] [--stats <file> [--perf]]"sv << std::endl;
+}
+
+// выполняет выбранный режим работы; ошибки выбрасываются исключениями
+void Run(const OutputSettings& output_settings, const std::string& ndjson_base, const std::string& server_base,
+    const std::string& client_socket, query_server::ServerSettings server_settings, bool perf) {
+    if (!client_socket.empty()) {
+        query_server::RunClient(client_socket, std::cin, std::cout);
+        return;
+    }
+    if (perf) {
+        // без счетчиков программа работает как обычно, причина отказа попадет в вывод статистики
+        stats::EnablePerfCounters();
+    }
+    if (!server_base.empty()) {
+        if (!output_settings.stats_path.empty()) {
+            server_settings.on_user_signal = [&output_settings] {
+                WriteStats(output_settings.stats_path);
+            };
+        }
+        RunServer(server_base, std::move(server_settings), output_settings);
+    }
+    else if (!ndjson_base.empty()) {
+        ServeNdjson(ndjson_base, output_settings);
+    }
+    else {
+        //TestSVG2();
+        TestAll2(output_settings);
+    }
+    if (!output_settings.stats_path.empty()) {
+        WriteStats(output_settings.stats_path);
+    }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    OutputSettings output_settings;
+    std::string ndjson_base;
+    std::string server_base;
+    std::string client_socket;
+    query_server::ServerSettings server_settings;
+    bool perf = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--compact"sv) {
+            output_settings.compact = true;
+        }
+        else if (arg == "--buffered"sv) {
+            output_settings.buffered = true;
+        }
+        else if (arg == "--msgpack"sv) {
+            output_settings.msgpack = true;
+        }
+        // --ndjson <base> - режим долгоживущего процесса
+        else if (arg == "--ndjson"sv && i + 1 < argc) {
+            ndjson_base = argv[++i];
+        }
+        // --server <socket> <base> - сервер запросов, --client <socket> - клиент к нему
+        else if (arg == "--server"sv && i + 2 < argc) {
+            server_settings.socket_path = argv[++i];
+            server_base = argv[++i];
+        }
+        else if (arg == "--workers"sv && i + 1 < argc) {
+            const std::optional<size_t> worker_count = ParseWorkerCount(argv[++i]);
+            if (!worker_count) {
+                std::cerr << "--workers expects a positive number, got "sv << argv[i] << std::endl;
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            server_settings.worker_count = *worker_count;
+        }
+        else if (arg == "--client"sv && i + 1 < argc) {
+            client_socket = argv[++i];
+        }
+        else if (arg == "--stats"sv && i + 1 < argc) {
+            output_settings.stats_path = argv[++i];
+        }
+        // --perf: добавить к статистике фаз аппаратные счетчики процессора
+        else if (arg == "--perf"sv) {
+            perf = true;
+        }
+        else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
 
-    //TestSVG2();
-    TestAll2();
+    if (perf && output_settings.stats_path.empty()) {
+        output_settings.stats_path = "-"s;
+    }
+    try {
+        Run(output_settings, ndjson_base, server_base, client_socket, std::move(server_settings), perf);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: "sv << e.what() << std::endl;
+        return 1;
+    }
     return 0;
 }
@@ -1,13 +1,22 @@
 #include "map_renderer.h"
 
 inline const double EPSILON = 1e-6;
+const svg::Color STOP_FILL_COLOR = "white"s;
+const svg::Color STOP_LABEL_COLOR = "black"s;
 bool IsZero(double value) {
     return std::abs(value) < EPSILON;
 }
 
-svg::Document MapRenderer::RenderMap(const transport_catalogue::TransportCatalogue& catalogue) {
+void MapRenderer::UpdateFieldSize(const transport_catalogue::TransportCatalogue& catalogue) {
+    // границы карты пересчитываются только после изменения маршрутов или координат остановок
+    if (field_size_version_ != catalogue.GetGeometryVersion()) {
+        field_size_ = ComputeFieldSize(catalogue);
+        field_size_version_ = catalogue.GetGeometryVersion();
+    }
+}
 
-    field_size_ = ComputeFieldSize(catalogue);
+void MapRenderer::RenderMap(const transport_catalogue::TransportCatalogue& catalogue, std::ostream& out) {
+    UpdateFieldSize(catalogue);
 
     const auto& routes = catalogue.GetRoutes();
     const auto& stops = catalogue.GetStops();
@@ -24,107 +33,98 @@ svg::Document MapRenderer::RenderMap(const transport_catalogue::TransportCatalog
 
     const auto& buses_on_stops = catalogue.GetBusesOnStops();
 
-    svg::Document doc;
-    RenderLines(doc, sorted_routes);
-    RenderRouteNames(doc, sorted_routes);
-    RenderStops(doc, sorted_stops, buses_on_stops);
-    RenderStopNames(doc, sorted_stops, buses_on_stops);
-    return doc;
+    svg::StreamWriter writer(out);
+    RenderLines(writer, sorted_routes);
+    RenderRouteNames(writer, sorted_routes);
+    RenderStops(writer, sorted_stops, buses_on_stops);
+    RenderStopNames(writer, sorted_stops, buses_on_stops);
+    writer.Finish();
 }
 
-void MapRenderer::RenderLines(svg::Document& doc, const std::map<std::string_view, const Route*>& routes) const {
+svg::PathStyle MapRenderer::GetUnderlayerStyle() const {
+    return { &settings_.underlayer_color, &settings_.underlayer_color, settings_.underlayer_width,
+        svg::StrokeLineCap::ROUND, svg::StrokeLineJoin::ROUND };
+}
+
+void MapRenderer::RenderLines(svg::StreamWriter& writer, const std::map<std::string_view, const Route*>& routes) const {
     auto max_color_count = settings_.color_palette.size();
     size_t color_index = 0;
     for (const auto& route : routes) {
         // работает только не с пустыми маршрутами
         if (route.second->stops.size() > 0) {
-            // задаём параметры рисования линии
-            svg::Polyline line;
-            line.SetStrokeColor(settings_.color_palette.at(color_index % max_color_count)).
-                SetFillColor(svg::NoneColor).SetStrokeWidth(settings_.line_width).
-                SetStrokeLineCap(svg::StrokeLineCap::ROUND).SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+            writer.BeginPolyline();
             // проходим по маршруту, добавляя точки от первой остановки до последней
             for (auto iter = route.second->stops.begin(); iter < route.second->stops.end(); ++iter) {
-                line.AddPoint(GetRelativePoint((*iter)->coordinate));
+                writer.AddPolylinePoint(GetRelativePoint((*iter)->coordinate));
             }
             // проходим по маршруту назад если он не кольцевой
             if (route.second->route_type == RouteType::LINEAR) {
                 for (auto iter = std::next(route.second->stops.rbegin()); iter < route.second->stops.rend(); ++iter) {
-                    line.AddPoint(GetRelativePoint((*iter)->coordinate));
+                    writer.AddPolylinePoint(GetRelativePoint((*iter)->coordinate));
                 }
             }
-            doc.Add(line);
+            // параметры рисования линии
+            writer.EndPolyline({ &svg::NoneColor, &settings_.color_palette.at(color_index % max_color_count),
+                settings_.line_width, svg::StrokeLineCap::ROUND, svg::StrokeLineJoin::ROUND });
             ++color_index;
         }
     }
 }
 
-void MapRenderer::RenderRouteNames(svg::Document& doc, const std::map<std::string_view, const Route*>& routes) const {
+void MapRenderer::RenderRouteNames(svg::StreamWriter& writer, const std::map<std::string_view, const Route*>& routes) const {
     auto max_color_count = settings_.color_palette.size();
     size_t color_index = 0;
     for (const auto& route : routes) {
         // работает только не с пустыми маршрутами
         if (route.second->stops.size() > 0) {
             // задаем общие параметры отрисовки текста и подложки
-            svg::Text text, underlayer_text;
-            text.SetData(std::string(route.first)).
-                SetPosition(GetRelativePoint(route.second->stops.front()->coordinate)).
-                SetOffset(settings_.bus_label_offset).
-                SetFontSize(static_cast<std::uint32_t>(settings_.bus_label_font_size)).
-                SetFontFamily("Verdana"s).SetFontWeight("bold");
-            underlayer_text = text;
+            svg::TextStyle text{ {}, settings_.bus_label_offset,
+                static_cast<std::uint32_t>(settings_.bus_label_font_size), "Verdana"sv, "bold"sv };
+            svg::TextStyle underlayer_text = text;
             // добавляем индивидуальные для текста и подложки параметры
-            text.SetFillColor(settings_.color_palette.at(color_index % max_color_count));
-            underlayer_text.SetFillColor(settings_.underlayer_color).SetStrokeColor(settings_.underlayer_color).
-                SetStrokeWidth(settings_.underlayer_width).
-                SetStrokeLineCap(svg::StrokeLineCap::ROUND).SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+            text.path.fill_color = &settings_.color_palette.at(color_index % max_color_count);
+            underlayer_text.path = GetUnderlayerStyle();
             // отрисовываем название маршрута у первой остановки
-            doc.Add(underlayer_text);
-            doc.Add(text);
+            const svg::Point first_position = GetRelativePoint(route.second->stops.front()->coordinate);
+            writer.AddText(first_position, route.first, underlayer_text);
+            writer.AddText(first_position, route.first, text);
             // если маршрут не кольцевой и первая остановка не совпадает с последней
             // то отрисовываем название маршрута у последней остановки
             if (route.second->route_type == RouteType::LINEAR && route.second->stops.back() != route.second->stops.front()) {
-                text.SetPosition(GetRelativePoint(route.second->stops.back()->coordinate));
-                underlayer_text.SetPosition(GetRelativePoint(route.second->stops.back()->coordinate));
-                doc.Add(underlayer_text);
-                doc.Add(text);
+                const svg::Point last_position = GetRelativePoint(route.second->stops.back()->coordinate);
+                writer.AddText(last_position, route.first, underlayer_text);
+                writer.AddText(last_position, route.first, text);
             }
             ++color_index;
         }
     }
 }
 
-void MapRenderer::RenderStops(svg::Document& doc, const std::map<std::string_view, const Stop*>& stops, const std::unordered_map<std::string_view, std::set<std::string_view>>& buses_on_stops) const {
+void MapRenderer::RenderStops(svg::StreamWriter& writer, const std::map<std::string_view, const Stop*>& stops, const std::unordered_map<std::string_view, std::set<std::string_view>>& buses_on_stops) const {
+    svg::PathStyle style;
+    style.fill_color = &STOP_FILL_COLOR;
     for (const auto& stop : stops) {
         // проходим по всем остановкам, которые входят в какой либо маршрут
         if (buses_on_stops.count(stop.first) != 0) {
             // отрисовываем значок остановки
-            svg::Circle circle;
-            circle.SetCenter(GetRelativePoint(stop.second->coordinate)).
-                SetRadius(settings_.stop_radius).SetFillColor("white"s);
-            doc.Add(circle);
+            writer.AddCircle(GetRelativePoint(stop.second->coordinate), settings_.stop_radius, style);
         }
     }
 }
-void MapRenderer::RenderStopNames(svg::Document& doc, const std::map<std::string_view, const Stop*>& stops, const std::unordered_map<std::string_view, std::set<std::string_view>>& buses_on_stops) const {
+void MapRenderer::RenderStopNames(svg::StreamWriter& writer, const std::map<std::string_view, const Stop*>& stops, const std::unordered_map<std::string_view, std::set<std::string_view>>& buses_on_stops) const {
+    // оформление текста и подложки одинаково для всех остановок
+    svg::TextStyle text{ {}, settings_.stop_label_offset,
+        static_cast<std::uint32_t>(settings_.stop_label_font_size), "Verdana"sv, {} };
+    svg::TextStyle underlayer_text = text;
+    text.path.fill_color = &STOP_LABEL_COLOR;
+    underlayer_text.path = GetUnderlayerStyle();
     for (const auto& stop : stops) {
         // проходим по всем остановкам, которые входят в какой либо маршрут
         if (buses_on_stops.count(stop.first) != 0) {
-            // формируем текст и подложку
-            svg::Text text, underlayer_text;
-            text.SetData(std::string(stop.first)).SetPosition(GetRelativePoint(stop.second->coordinate)).
-                SetOffset(settings_.stop_label_offset).
-                SetFontSize(static_cast<std::uint32_t>(settings_.stop_label_font_size)).
-                SetFontFamily("Verdana");
-            underlayer_text = text;
-            // добавляем индивидуальные для текста и подложки параметры
-            text.SetFillColor("black");
-            underlayer_text.SetFillColor(settings_.underlayer_color).SetStrokeColor(settings_.underlayer_color).
-                SetStrokeWidth(settings_.underlayer_width).
-                SetStrokeLineCap(svg::StrokeLineCap::ROUND).SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
             // отрисовываем подложку и текст
-            doc.Add(underlayer_text);
-            doc.Add(text);
+            const svg::Point position = GetRelativePoint(stop.second->coordinate);
+            writer.AddText(position, stop.first, underlayer_text);
+            writer.AddText(position, stop.first, text);
         }
     }
 }
@@ -133,21 +133,14 @@ void MapRenderer::RenderStopNames(svg::Document& doc, const std::map<std::string
 std::pair<Coordinates, Coordinates> MapRenderer::ComputeFieldSize(const transport_catalogue::TransportCatalogue& catalogue) const {
     Coordinates min{ 90.0, 180.0 };
     Coordinates max{ -90.0, -180.0 };
-    for (const auto& stop : catalogue.GetStops()) {
-        if (!catalogue.GetBusesOnStop(std::string(stop.first)).empty()) {
-            const Coordinates& coordinates = stop.second->coordinate;
-            if (coordinates.lat < min.lat) {
-                min.lat = coordinates.lat;
-            }
-            if (coordinates.lat > max.lat) {
-                max.lat = coordinates.lat;
-            }
-            if (coordinates.lng < min.lng) {
-                min.lng = coordinates.lng;
-            }
-            if (coordinates.lng > max.lng) {
-                max.lng = coordinates.lng;
-            }
+    // последовательно проходим по массивам координат, учитывая только остановки на маршрутах
+    const StopCoordinates& coordinates = catalogue.GetStopCoordinates();
+    for (size_t id = 0; id < coordinates.Size(); ++id) {
+        if (coordinates.on_route[id]) {
+            min.lat = std::min(min.lat, coordinates.lat[id]);
+            max.lat = std::max(max.lat, coordinates.lat[id]);
+            min.lng = std::min(min.lng, coordinates.lng[id]);
+            max.lng = std::max(max.lng, coordinates.lng[id]);
         }
     }
     return std::pair<Coordinates, Coordinates>{min, max};
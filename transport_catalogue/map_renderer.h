@@ -1,5 +1,6 @@
 #pragma once
 #include <map>
+#include <optional>
 #include "svg.h"
 #include "geo.h"
 #include "transport_catalogue.h"
@@ -32,15 +33,23 @@ public:
     void SetSettings(const RenderSettings& settings) {
         settings_ = settings;
     }
+    const RenderSettings& GetSettings() const {
+        return settings_;
+    }
 
-    //формирование всей карты
-    svg::Document RenderMap(const transport_catalogue::TransportCatalogue& catalogue);
+    //формирование всей карты: теги SVG пишутся в out по ходу обхода каталога, без построения svg::Document
+    void RenderMap(const transport_catalogue::TransportCatalogue& catalogue, std::ostream& out);
+    // пересчитывает границы карты, если маршруты или координаты остановок изменились с прошлого раза
+    // после вызова RenderMap по неизменному каталогу состояние отрисовщика не меняет
+    void UpdateFieldSize(const transport_catalogue::TransportCatalogue& catalogue);
 private:
     //функции отрисовки всех даннх маршрута
-    void RenderLines(svg::Document& doc, const std::map<std::string_view, const Route*>& routes) const;
-    void RenderRouteNames(svg::Document& doc, const std::map<std::string_view, const Route*>& routes) const;
-    void RenderStops(svg::Document& doc, const std::map<std::string_view, const Stop*>& stops, const std::unordered_map<std::string_view, std::set<std::string_view>>& buses_on_stops) const;
-    void RenderStopNames(svg::Document& doc, const std::map<std::string_view, const Stop*>& stops, const std::unordered_map<std::string_view, std::set<std::string_view>>& buses_on_stops) const;
+    void RenderLines(svg::StreamWriter& writer, const std::map<std::string_view, const Route*>& routes) const;
+    void RenderRouteNames(svg::StreamWriter& writer, const std::map<std::string_view, const Route*>& routes) const;
+    void RenderStops(svg::StreamWriter& writer, const std::map<std::string_view, const Stop*>& stops, const std::unordered_map<std::string_view, std::set<std::string_view>>& buses_on_stops) const;
+    void RenderStopNames(svg::StreamWriter& writer, const std::map<std::string_view, const Stop*>& stops, const std::unordered_map<std::string_view, std::set<std::string_view>>& buses_on_stops) const;
+    // оформление подложки под названиями маршрутов и остановок
+    svg::PathStyle GetUnderlayerStyle() const;
 
     // возвращает пару - минимальная и максимальная координаты прямоугольника, в который вписаны все остановки на маршрутах
     std::pair<Coordinates, Coordinates> ComputeFieldSize(const transport_catalogue::TransportCatalogue& catalogue) const;
@@ -50,5 +59,7 @@ private:
 
     RenderSettings settings_;
     std::pair<Coordinates, Coordinates> field_size_;
+    // версия геометрии каталога, по которой посчитан field_size_
+    std::optional<uint64_t> field_size_version_;
 };
 
@@ -0,0 +1,240 @@
+#include "perf_counters.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace stats {
+
+    using namespace std::literals;
+
+    namespace {
+
+        constexpr std::array<std::string_view, PERF_EVENT_COUNT> PERF_EVENT_NAMES = {
+            "cycles"sv,
+            "instructions"sv,
+            "llc_misses"sv,
+            "branch_misses"sv,
+        };
+
+        std::atomic<bool> perf_enabled = false;
+        // пишется только в EnablePerfCounters, до запуска рабочих потоков
+        std::string perf_status = "off"s;
+
+#if defined(__linux__)
+
+        struct PerfEventConfig {
+            uint32_t type;
+            uint64_t config;
+        };
+
+        constexpr std::array<PerfEventConfig, PERF_EVENT_COUNT> PERF_EVENT_CONFIGS = {
+            PerfEventConfig{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            PerfEventConfig{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            PerfEventConfig{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL
+                | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+            PerfEventConfig{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        };
+
+        // формат чтения группы с PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING:
+        // время общее для всей группы, значения идут в порядке подключения счетчиков к группе
+        struct PerfGroupReadFormat {
+            uint64_t count;
+            uint64_t time_enabled;
+            uint64_t time_running;
+            std::array<uint64_t, PERF_EVENT_COUNT> values;
+        };
+
+        // счетчики одного потока объединены в группу: ядро включает их одновременно, и все показания
+        // снимаются одним read с первого открытого счетчика; счетчик, который не удалось открыть, недоступен,
+        // а остальные работают без него
+        class ThreadCounters {
+        public:
+            ThreadCounters() {
+                for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+                    perf_event_attr attr;
+                    std::memset(&attr, 0, sizeof(attr));
+                    attr.size = sizeof(attr);
+                    attr.type = PERF_EVENT_CONFIGS[i].type;
+                    attr.config = PERF_EVENT_CONFIGS[i].config;
+                    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                    // без ядра и гипервизора счетчики доступны и при perf_event_paranoid = 2
+                    attr.exclude_kernel = 1;
+                    attr.exclude_hv = 1;
+                    const int leader = group_size_ == 0 ? -1 : fds_[group_events_[0]];
+                    const long fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, leader, PERF_FLAG_FD_CLOEXEC);
+                    if (fd >= 0) {
+                        fds_[i] = static_cast<int>(fd);
+                        group_events_[group_size_++] = i;
+                    }
+                    else if (first_error_ == 0) {
+                        first_error_ = errno;
+                    }
+                }
+            }
+            ThreadCounters(const ThreadCounters&) = delete;
+            ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+            ~ThreadCounters() {
+                // участники группы закрываются раньше ее лидера
+                for (size_t i = group_size_; i > 0; --i) {
+                    ::close(fds_[group_events_[i - 1]]);
+                }
+            }
+
+            bool IsAnyOpen() const noexcept {
+                return group_size_ > 0;
+            }
+
+            int GetFirstError() const noexcept {
+                return first_error_;
+            }
+
+            PerfSample Read() const noexcept {
+                PerfSample sample;
+                if (group_size_ == 0) {
+                    return sample;
+                }
+                PerfGroupReadFormat data;
+                const auto expected = static_cast<ssize_t>(offsetof(PerfGroupReadFormat, values) + group_size_ * sizeof(uint64_t));
+                if (::read(fds_[group_events_[0]], &data, sizeof(data)) != expected || data.count != group_size_) {
+                    return sample;
+                }
+                for (size_t slot = 0; slot < group_size_; ++slot) {
+                    const size_t i = group_events_[slot];
+                    sample.values[i] = data.values[slot];
+                    sample.time_enabled[i] = data.time_enabled;
+                    sample.time_running[i] = data.time_running;
+                    sample.available[i] = true;
+                }
+                return sample;
+            }
+
+        private:
+            std::array<int, PERF_EVENT_COUNT> fds_ = { -1, -1, -1, -1 };
+            // события в порядке подключения к группе, первое - лидер группы
+            std::array<size_t, PERF_EVENT_COUNT> group_events_{};
+            size_t group_size_ = 0;
+            int first_error_ = 0;
+        };
+
+        ThreadCounters& GetThreadCounters() {
+            thread_local ThreadCounters counters;
+            return counters;
+        }
+
+#endif
+
+    } // namespace
+
+    std::string_view GetPerfEventName(PerfEvent event) noexcept {
+        return PERF_EVENT_NAMES[static_cast<size_t>(event)];
+    }
+
+#if defined(__linux__)
+
+    bool EnablePerfCounters() {
+        const ThreadCounters& counters = GetThreadCounters();
+        if (!counters.IsAnyOpen()) {
+            perf_status = "unavailable: "s + std::strerror(counters.GetFirstError());
+            return false;
+        }
+        perf_status = "on"s;
+        perf_enabled.store(true, std::memory_order_release);
+        return true;
+    }
+
+    PerfSample ReadPerfCounters() noexcept {
+        if (!perf_enabled.load(std::memory_order_acquire)) {
+            return {};
+        }
+        try {
+            return GetThreadCounters().Read();
+        }
+        catch (...) {
+            // не хватило памяти под счетчики нового потока - замер просто пропускается
+            return {};
+        }
+    }
+
+#else
+
+    bool EnablePerfCounters() {
+        perf_status = "unavailable: perf_event_open requires Linux"s;
+        return false;
+    }
+
+    PerfSample ReadPerfCounters() noexcept {
+        return {};
+    }
+
+#endif
+
+    bool IsPerfEnabled() noexcept {
+        return perf_enabled.load(std::memory_order_acquire);
+    }
+
+    std::string GetPerfStatus() {
+        return perf_status;
+    }
+
+    PerfSample GetPerfDelta(const PerfSample& start, const PerfSample& finish) noexcept {
+        PerfSample delta;
+        for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+            if (!start.available[i] || !finish.available[i]) {
+                continue;
+            }
+            const uint64_t enabled = finish.time_enabled[i] - start.time_enabled[i];
+            const uint64_t running = finish.time_running[i] - start.time_running[i];
+            // счетчик ни разу не попал на процессор за время замера - оценить его нельзя
+            if (running == 0) {
+                continue;
+            }
+            const uint64_t value = finish.values[i] - start.values[i];
+            delta.values[i] = running == enabled
+                ? value
+                : static_cast<uint64_t>(static_cast<double>(value) * static_cast<double>(enabled) / static_cast<double>(running));
+            delta.time_enabled[i] = enabled;
+            delta.time_running[i] = running;
+            delta.available[i] = true;
+        }
+        return delta;
+    }
+
+    PerfSample AddPerf(const PerfSample& lhs, const PerfSample& rhs) noexcept {
+        PerfSample sum;
+        for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+            if (!lhs.available[i] || !rhs.available[i]) {
+                continue;
+            }
+            sum.values[i] = lhs.values[i] + rhs.values[i];
+            sum.time_enabled[i] = lhs.time_enabled[i] + rhs.time_enabled[i];
+            sum.time_running[i] = lhs.time_running[i] + rhs.time_running[i];
+            sum.available[i] = true;
+        }
+        return sum;
+    }
+
+    PerfSample SubtractPerf(const PerfSample& total, const PerfSample& part) noexcept {
+        PerfSample difference;
+        for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+            if (!total.available[i] || !part.available[i]) {
+                continue;
+            }
+            difference.values[i] = total.values[i] - std::min(part.values[i], total.values[i]);
+            difference.time_enabled[i] = total.time_enabled[i] - std::min(part.time_enabled[i], total.time_enabled[i]);
+            difference.time_running[i] = total.time_running[i] - std::min(part.time_running[i], total.time_running[i]);
+            difference.available[i] = true;
+        }
+        return difference;
+    }
+
+} // namespace stats
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Аппаратные счетчики процессора через perf_event_open: такты, инструкции, промахи кэша последнего уровня
+// и промахи предсказания переходов. Счетчики открываются для каждого потока отдельно при первом чтении одной
+// группой и считают только этот поток в пользовательском режиме; одно чтение - один системный вызов, поэтому
+// читать их стоит только на границах фаз. Если ядро их не дает (нет прав, виртуальная машина, не Linux),
+// чтение просто возвращает пустой замер
+namespace stats {
+
+    enum class PerfEvent {
+        CYCLES,
+        INSTRUCTIONS,
+        LLC_MISSES,
+        BRANCH_MISSES,
+    };
+
+    inline constexpr size_t PERF_EVENT_COUNT = 4;
+
+    std::string_view GetPerfEventName(PerfEvent event) noexcept;
+
+    // показания счетчиков; счетчик, который не удалось открыть или который не работал, помечен как недоступный
+    // значения приведены с учетом мультиплексирования: если ядро давало счетчику только часть времени,
+    // показание растягивается пропорционально
+    struct PerfSample {
+        std::array<uint64_t, PERF_EVENT_COUNT> values{};
+        std::array<bool, PERF_EVENT_COUNT> available{};
+        // время, которое счетчики были включены и реально считали, для пересчета разностей
+        std::array<uint64_t, PERF_EVENT_COUNT> time_enabled{};
+        std::array<uint64_t, PERF_EVENT_COUNT> time_running{};
+    };
+
+    // включает счетчики: пробует открыть их в текущем потоке и возвращает, удалось ли открыть хоть один
+    // причину отказа можно узнать через GetPerfStatus
+    bool EnablePerfCounters();
+    bool IsPerfEnabled() noexcept;
+    // "off", "on" или "unavailable: <причина>"
+    std::string GetPerfStatus();
+
+    // показания счетчиков текущего потока; пусто, если счетчики не включены
+    PerfSample ReadPerfCounters() noexcept;
+    // прирост счетчиков между двумя показаниями одного потока
+    PerfSample GetPerfDelta(const PerfSample& start, const PerfSample& finish) noexcept;
+    // сумма и разность приростов; счетчик доступен в результате, только если доступен в обоих
+    // разность не бывает меньше нуля: после пересчета мультиплексированных счетчиков часть может оказаться больше целого
+    PerfSample AddPerf(const PerfSample& lhs, const PerfSample& rhs) noexcept;
+    PerfSample SubtractPerf(const PerfSample& total, const PerfSample& part) noexcept;
+
+} // namespace stats
@@ -0,0 +1,575 @@
+#include "query_server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#if defined(__linux__)
+#include <csignal>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace query_server {
+
+    using namespace std::literals;
+
+    // ------------------------- FileDescriptor -------------------------
+
+    FileDescriptor::FileDescriptor(int fd) : fd_(fd) {
+    }
+
+    FileDescriptor::FileDescriptor(FileDescriptor&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {
+    }
+
+    FileDescriptor& FileDescriptor::operator=(FileDescriptor&& other) noexcept {
+        if (this != &other) {
+            Close();
+            fd_ = std::exchange(other.fd_, -1);
+        }
+        return *this;
+    }
+
+    FileDescriptor::~FileDescriptor() {
+        Close();
+    }
+
+    int FileDescriptor::Get() const noexcept {
+        return fd_;
+    }
+
+    bool FileDescriptor::IsValid() const noexcept {
+        return fd_ >= 0;
+    }
+
+#if defined(__linux__)
+
+    void FileDescriptor::Close() noexcept {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    namespace {
+
+        // служебные значения epoll_event::data, соединения нумеруются после них
+        constexpr uint64_t LISTEN_EVENT = 0;
+        constexpr uint64_t WAKE_EVENT = 1;
+        constexpr uint64_t SIGNAL_EVENT = 2;
+        constexpr uint64_t FIRST_CONNECTION_ID = 3;
+
+        constexpr size_t BLOCK_SIZE = 1 << 16;
+        constexpr int MAX_EVENTS = 64;
+
+        std::system_error SystemError(const char* what) {
+            return std::system_error(errno, std::generic_category(), what);
+        }
+
+        FileDescriptor CheckedDescriptor(int fd, const char* what) {
+            if (fd < 0) {
+                throw SystemError(what);
+            }
+            return FileDescriptor(fd);
+        }
+
+        sockaddr_un MakeAddress(const std::string& path) {
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+                throw std::invalid_argument("Invalid socket path: "s + path);
+            }
+            std::memcpy(address.sun_path, path.data(), path.size());
+            return address;
+        }
+
+        // убирает файл сокета, оставшийся от прошлого запуска; всё, что не является сокетом, не трогается,
+        // как и сокет, который ещё кто-то слушает
+        void RemoveStaleSocket(const std::string& path, const sockaddr_un& address) {
+            struct stat file_stat;
+            if (lstat(path.c_str(), &file_stat) < 0) {
+                if (errno == ENOENT) {
+                    return;
+                }
+                throw SystemError("lstat");
+            }
+            if (!S_ISSOCK(file_stat.st_mode)) {
+                throw std::runtime_error("Refusing to replace "s + path + ": it exists and is not a socket"s);
+            }
+            const FileDescriptor probe = CheckedDescriptor(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0), "socket");
+            if (connect(probe.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+                throw std::runtime_error("Socket "s + path + " is in use by another server"s);
+            }
+            if (unlink(path.c_str()) < 0 && errno != ENOENT) {
+                throw SystemError("unlink");
+            }
+        }
+
+        bool IsBlankLine(std::string_view line) {
+            return line.find_first_not_of(" \t\r") == std::string_view::npos;
+        }
+
+        void ControlEpoll(int epoll_fd, int operation, int fd, uint32_t events, uint64_t data) {
+            epoll_event event{};
+            event.events = events;
+            event.data.u64 = data;
+            if (epoll_ctl(epoll_fd, operation, fd, &event) < 0) {
+                throw SystemError("epoll_ctl");
+            }
+        }
+
+        // отправляет блок целиком, при разрыве соединения возвращает false
+        bool SendAll(int fd, std::string_view data) {
+            while (!data.empty()) {
+                const ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+                if (sent < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                data.remove_prefix(static_cast<size_t>(sent));
+            }
+            return true;
+        }
+
+    } // namespace
+
+    // -------------------------- QueryServer ---------------------------
+
+    QueryServer::QueryServer(RequestHandler& request_handler, ServerSettings settings)
+        : request_handler_(request_handler)
+        , settings_(std::move(settings))
+        , wake_fd_(CheckedDescriptor(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), "eventfd")) {
+        if (settings_.worker_count == 0) {
+            settings_.worker_count = std::max(1u, std::thread::hardware_concurrency());
+        }
+        // все ленивые кэши заполняются до запуска обработчиков, дальше они только читаются
+        request_handler_.Prepare(RequestHandler::LINE_PRINT_OPTIONS);
+    }
+
+    QueryServer::~QueryServer() {
+        {
+            std::lock_guard lock(tasks_mutex_);
+            workers_stopping_ = true;
+            tasks_.clear();
+        }
+        tasks_cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    void QueryServer::Stop() {
+        stop_requested_ = true;
+        const uint64_t one = 1;
+        [[maybe_unused]] const ssize_t result = write(wake_fd_.Get(), &one, sizeof(one));
+    }
+
+    void QueryServer::Run() {
+        // SIGINT, SIGTERM и SIGUSR1 принимаются через signalfd; маску наследуют потоки-обработчики, созданные ниже
+        sigset_t handled_signals;
+        sigemptyset(&handled_signals);
+        sigaddset(&handled_signals, SIGINT);
+        sigaddset(&handled_signals, SIGTERM);
+        sigaddset(&handled_signals, SIGUSR1);
+        sigset_t old_mask;
+        pthread_sigmask(SIG_BLOCK, &handled_signals, &old_mask);
+        signal_fd_ = CheckedDescriptor(signalfd(-1, &handled_signals, SFD_NONBLOCK | SFD_CLOEXEC), "signalfd");
+
+        const sockaddr_un address = MakeAddress(settings_.socket_path);
+        listen_fd_ = CheckedDescriptor(socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0), "socket");
+        // файл сокета от предыдущего запуска мешает bind
+        RemoveStaleSocket(settings_.socket_path, address);
+        if (bind(listen_fd_.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+            throw SystemError("bind");
+        }
+        // запоминаем созданный файл, чтобы при выходе удалить именно его
+        if (struct stat socket_stat; lstat(settings_.socket_path.c_str(), &socket_stat) == 0) {
+            socket_device_ = static_cast<uint64_t>(socket_stat.st_dev);
+            socket_inode_ = static_cast<uint64_t>(socket_stat.st_ino);
+        }
+        if (listen(listen_fd_.Get(), SOMAXCONN) < 0) {
+            throw SystemError("listen");
+        }
+
+        epoll_fd_ = CheckedDescriptor(epoll_create1(EPOLL_CLOEXEC), "epoll_create1");
+        ControlEpoll(epoll_fd_.Get(), EPOLL_CTL_ADD, listen_fd_.Get(), EPOLLIN, LISTEN_EVENT);
+        ControlEpoll(epoll_fd_.Get(), EPOLL_CTL_ADD, wake_fd_.Get(), EPOLLIN, WAKE_EVENT);
+        ControlEpoll(epoll_fd_.Get(), EPOLL_CTL_ADD, signal_fd_.Get(), EPOLLIN, SIGNAL_EVENT);
+        next_connection_id_ = FIRST_CONNECTION_ID;
+
+        workers_.reserve(settings_.worker_count);
+        for (size_t i = 0; i < settings_.worker_count; ++i) {
+            workers_.emplace_back([this] {
+                WorkerLoop();
+            });
+        }
+
+        epoll_event events[MAX_EVENTS];
+        while (!stop_requested_) {
+            const int count = epoll_wait(epoll_fd_.Get(), events, MAX_EVENTS, -1);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw SystemError("epoll_wait");
+            }
+            for (int i = 0; i < count; ++i) {
+                const uint64_t id = events[i].data.u64;
+                if (id == LISTEN_EVENT) {
+                    AcceptConnections();
+                }
+                else if (id == WAKE_EVENT) {
+                    uint64_t value;
+                    [[maybe_unused]] const ssize_t result = read(wake_fd_.Get(), &value, sizeof(value));
+                    DrainCompletions();
+                }
+                else if (id == SIGNAL_EVENT) {
+                    signalfd_siginfo info;
+                    if (read(signal_fd_.Get(), &info, sizeof(info)) != sizeof(info)) {
+                        continue;
+                    }
+                    if (info.ssi_signo != SIGUSR1) {
+                        stop_requested_ = true;
+                    }
+                    else if (settings_.on_user_signal) {
+                        settings_.on_user_signal();
+                    }
+                }
+                else if (auto it = connections_.find(id); it != connections_.end()) {
+                    Connection& connection = it->second;
+                    if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                        // клиент закрыл сокет целиком - ответы доставить уже некому
+                        connection.broken = true;
+                    }
+                    else {
+                        if (events[i].events & EPOLLIN) {
+                            ReadConnection(id, connection);
+                        }
+                        if (events[i].events & EPOLLOUT) {
+                            WriteConnection(connection);
+                        }
+                    }
+                    UpdateConnection(id);
+                }
+            }
+        }
+
+        {
+            std::lock_guard lock(tasks_mutex_);
+            workers_stopping_ = true;
+            tasks_.clear();
+        }
+        tasks_cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+        workers_.clear();
+
+        connections_.clear();
+        epoll_fd_.Close();
+        listen_fd_.Close();
+        signal_fd_.Close();
+        // файл по этому пути могли заменить, пока сервер работал, - удаляем только свой сокет
+        if (struct stat socket_stat; lstat(settings_.socket_path.c_str(), &socket_stat) == 0 && S_ISSOCK(socket_stat.st_mode)
+            && static_cast<uint64_t>(socket_stat.st_dev) == socket_device_ && static_cast<uint64_t>(socket_stat.st_ino) == socket_inode_) {
+            unlink(settings_.socket_path.c_str());
+        }
+        pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+    }
+
+    void QueryServer::WorkerLoop() {
+        // у каждого обработчика своя арена для узлов запроса и ответа
+        std::pmr::monotonic_buffer_resource arena;
+        std::ostringstream output;
+        while (true) {
+            Task task;
+            {
+                std::unique_lock lock(tasks_mutex_);
+                tasks_cv_.wait(lock, [this] {
+                    return workers_stopping_ || !tasks_.empty();
+                });
+                if (workers_stopping_) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+
+            output.str({});
+            try {
+                request_handler_.AnswerLine(task.line, output, &arena);
+            }
+            catch (const std::exception&) {
+                // ответ нужен на каждую строку, иначе остановятся все следующие ответы соединения
+                output.str({});
+                output << "{\"error_message\":\"internal error\"}\n"sv;
+            }
+            arena.release();
+
+            {
+                std::lock_guard lock(completions_mutex_);
+                completions_.push_back({ task.connection_id, task.sequence, output.str() });
+            }
+            const uint64_t one = 1;
+            [[maybe_unused]] const ssize_t result = write(wake_fd_.Get(), &one, sizeof(one));
+        }
+    }
+
+    void QueryServer::PushTasks(std::vector<Task>& tasks) {
+        if (tasks.empty()) {
+            return;
+        }
+        {
+            std::lock_guard lock(tasks_mutex_);
+            for (auto& task : tasks) {
+                tasks_.push_back(std::move(task));
+            }
+        }
+        tasks_cv_.notify_all();
+        tasks.clear();
+    }
+
+    void QueryServer::AcceptConnections() {
+        while (true) {
+            const int fd = accept4(listen_fd_.Get(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                // EAGAIN - очередь подключений пуста; при нехватке дескрипторов подключение подождет в очереди
+                return;
+            }
+            const uint64_t id = next_connection_id_++;
+            Connection& connection = connections_[id];
+            connection.fd = FileDescriptor(fd);
+            connection.events = EPOLLIN;
+            ControlEpoll(epoll_fd_.Get(), EPOLL_CTL_ADD, fd, connection.events, id);
+        }
+    }
+
+    void QueryServer::ReadConnection(uint64_t id, Connection& connection) {
+        // за одно событие читается один блок, остальное придет следующим событием epoll,
+        // чтобы одно соединение не задерживало остальные
+        char buffer[BLOCK_SIZE];
+        const ssize_t size = recv(connection.fd.Get(), buffer, sizeof(buffer), 0);
+        if (size < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                connection.broken = true;
+            }
+            return;
+        }
+        if (size == 0) {
+            connection.read_closed = true;
+        }
+        connection.input.append(buffer, static_cast<size_t>(size));
+
+        std::vector<Task> tasks;
+        size_t line_begin = 0;
+        for (size_t line_end; (line_end = connection.input.find('\n', line_begin)) != std::string::npos; line_begin = line_end + 1) {
+            std::string_view line(connection.input.data() + line_begin, line_end - line_begin);
+            if (!IsBlankLine(line)) {
+                tasks.push_back({ id, connection.next_sequence++, std::string(line) });
+            }
+        }
+        connection.input.erase(0, line_begin);
+        // последняя строка без перевода строки - тоже запрос, как у std::getline
+        if (connection.read_closed && !IsBlankLine(connection.input)) {
+            tasks.push_back({ id, connection.next_sequence++, std::move(connection.input) });
+            connection.input.clear();
+        }
+        if (connection.input.size() > settings_.max_request_size) {
+            connection.broken = true;
+            return;
+        }
+        PushTasks(tasks);
+    }
+
+    void QueryServer::WriteConnection(Connection& connection) {
+        while (connection.output_pos < connection.output.size()) {
+            const ssize_t sent = send(connection.fd.Get(), connection.output.data() + connection.output_pos,
+                connection.output.size() - connection.output_pos, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    connection.broken = true;
+                }
+                break;
+            }
+            connection.output_pos += static_cast<size_t>(sent);
+        }
+        // отправленное начало буфера удаляется, когда его накопилось больше, чем осталось отправить
+        if (connection.output_pos == connection.output.size()) {
+            connection.output.clear();
+            connection.output_pos = 0;
+        }
+        else if (connection.output_pos > connection.output.size() / 2) {
+            connection.output.erase(0, connection.output_pos);
+            connection.output_pos = 0;
+        }
+    }
+
+    void QueryServer::DrainCompletions() {
+        std::vector<Completion> completions;
+        {
+            std::lock_guard lock(completions_mutex_);
+            completions.swap(completions_);
+        }
+
+        std::vector<uint64_t> updated;
+        for (auto& completion : completions) {
+            auto it = connections_.find(completion.connection_id);
+            if (it == connections_.end()) {
+                // соединение закрылось, пока запрос обрабатывался
+                continue;
+            }
+            Connection& connection = it->second;
+            connection.ready.emplace(completion.sequence, std::move(completion.response));
+            // в выходной буфер переносятся только ответы, идущие подряд по порядку запросов
+            for (auto ready = connection.ready.begin(); ready != connection.ready.end() && ready->first == connection.next_to_send;
+                ready = connection.ready.erase(ready)) {
+                connection.output += ready->second;
+                ++connection.next_to_send;
+            }
+            updated.push_back(completion.connection_id);
+        }
+
+        std::sort(updated.begin(), updated.end());
+        updated.erase(std::unique(updated.begin(), updated.end()), updated.end());
+        for (uint64_t id : updated) {
+            WriteConnection(connections_.at(id));
+            UpdateConnection(id);
+        }
+    }
+
+    void QueryServer::UpdateConnection(uint64_t id) {
+        auto it = connections_.find(id);
+        if (it == connections_.end()) {
+            return;
+        }
+        Connection& connection = it->second;
+        const bool has_output = connection.output_pos < connection.output.size();
+        const bool has_pending = connection.next_to_send < connection.next_sequence;
+        if (connection.broken || (connection.read_closed && !has_pending && !has_output)) {
+            // закрытый дескриптор epoll удаляет из наблюдения сам
+            connections_.erase(it);
+            return;
+        }
+
+        uint32_t events = 0;
+        if (!connection.read_closed && connection.next_sequence - connection.next_to_send < settings_.max_pipelined_requests) {
+            events |= EPOLLIN;
+        }
+        if (has_output) {
+            events |= EPOLLOUT;
+        }
+        if (events != connection.events) {
+            ControlEpoll(epoll_fd_.Get(), EPOLL_CTL_MOD, connection.fd.Get(), events, id);
+            connection.events = events;
+        }
+    }
+
+    // ----------------------------- клиент -----------------------------
+
+    void RunClient(const std::string& socket_path, std::istream& input, std::ostream& output) {
+        const sockaddr_un address = MakeAddress(socket_path);
+        FileDescriptor fd = CheckedDescriptor(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0), "socket");
+        if (connect(fd.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+            throw SystemError("connect");
+        }
+
+        // запросы отправляются отдельным потоком, не дожидаясь ответов на предыдущие
+        // у потока своя копия дескриптора: если его придется отсоединить, номер сокета не достанется чужому файлу
+        auto sender_finished = std::make_shared<std::atomic<bool>>(false);
+        FileDescriptor sender_fd = CheckedDescriptor(fcntl(fd.Get(), F_DUPFD_CLOEXEC, 0), "fcntl");
+        std::thread sender([&input, sender_fd = std::move(sender_fd), sender_finished] {
+            std::string line;
+            std::string block;
+            bool connected = true;
+            while (connected && std::getline(input, line)) {
+                block += line;
+                block += '\n';
+                // копим строки, пока они есть во входном буфере, и отправляем их одним блоком
+                if (block.size() >= BLOCK_SIZE || input.rdbuf()->in_avail() <= 0) {
+                    connected = SendAll(sender_fd.Get(), block);
+                    block.clear();
+                }
+            }
+            if (connected) {
+                SendAll(sender_fd.Get(), block);
+                // сервер ответит на оставшиеся запросы и закроет соединение
+                shutdown(sender_fd.Get(), SHUT_WR);
+            }
+            sender_finished->store(true);
+        });
+
+        char buffer[BLOCK_SIZE];
+        ssize_t size;
+        while ((size = recv(fd.Get(), buffer, sizeof(buffer), 0)) != 0) {
+            if (size < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            output.write(buffer, size);
+            output.flush();
+        }
+        const int recv_error = size < 0 ? errno : 0;
+        // сервер закрыл соединение - отправлять дальше некуда
+        shutdown(fd.Get(), SHUT_RDWR);
+        // поток отправки может ждать ввода, который так и не придет (например, с терминала) -
+        // тогда его не ждем: следующая же отправка после ввода не удастся, и поток завершится сам
+        if (sender_finished->load()) {
+            sender.join();
+        }
+        else {
+            sender.detach();
+        }
+        if (recv_error != 0) {
+            throw std::system_error(recv_error, std::generic_category(), "recv");
+        }
+    }
+
+#else
+
+    void FileDescriptor::Close() noexcept {
+        fd_ = -1;
+    }
+
+    QueryServer::QueryServer(RequestHandler& request_handler, ServerSettings settings)
+        : request_handler_(request_handler)
+        , settings_(std::move(settings)) {
+        throw std::runtime_error("Query server is supported only on Linux");
+    }
+
+    QueryServer::~QueryServer() = default;
+
+    void QueryServer::Run() {
+    }
+
+    void QueryServer::Stop() {
+    }
+
+    void RunClient(const std::string&, std::istream&, std::ostream&) {
+        throw std::runtime_error("Query client is supported only on Linux");
+    }
+
+#endif
+
+} // namespace query_server
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "request_handler.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace query_server {
+
+    // владеет файловым дескриптором и закрывает его при уничтожении
+    class FileDescriptor {
+    public:
+        FileDescriptor() = default;
+        explicit FileDescriptor(int fd);
+        FileDescriptor(FileDescriptor&& other) noexcept;
+        FileDescriptor& operator=(FileDescriptor&& other) noexcept;
+        FileDescriptor(const FileDescriptor&) = delete;
+        FileDescriptor& operator=(const FileDescriptor&) = delete;
+        ~FileDescriptor();
+
+        int Get() const noexcept;
+        bool IsValid() const noexcept;
+        void Close() noexcept;
+
+    private:
+        int fd_ = -1;
+    };
+
+    struct ServerSettings {
+        std::string socket_path;
+        // число потоков, отвечающих на запросы; 0 - по числу ядер
+        size_t worker_count = 0;
+        // сколько запросов одного соединения может ждать ответа; пока очередь полна, соединение не читается
+        size_t max_pipelined_requests = 1024;
+        // строка запроса длиннее этого размера считается ошибкой клиента, соединение закрывается
+        size_t max_request_size = 16 << 20;
+        // вызывается из цикла событий по сигналу SIGUSR1, например, чтобы вывести статистику работающего сервера
+        std::function<void()> on_user_signal;
+    };
+
+    // Сервер запросов к уже загруженному каталогу через Unix domain socket
+    // протокол как в режиме NDJSON: запрос - одна строка JSON, ответ - одна строка в том же порядке
+    // клиент может отправлять запросы, не дожидаясь ответов (конвейер): строки одного соединения
+    // раздаются потокам-обработчикам параллельно, а ответы собираются обратно по порядку
+    // сокеты обслуживает один поток с циклом epoll, работает только под Linux
+    class QueryServer {
+    public:
+        // обработчик и его каталог должны жить дольше сервера, а каталог - не изменяться, пока сервер работает:
+        // потоки-обработчики отвечают через один RequestHandler без блокировок, после его Prepare
+        QueryServer(RequestHandler& request_handler, ServerSettings settings);
+        ~QueryServer();
+
+        // принимает соединения, пока не придет SIGINT или SIGTERM или не будет вызван Stop
+        // SIGUSR1 вызывает ServerSettings::on_user_signal
+        // файл сокета от прошлого запуска заменяется, а любой другой файл по этому пути - ошибка
+        // при выходе дожидается обработчиков, закрывает соединения и удаляет созданный им файл сокета
+        void Run();
+
+        // просит Run завершиться, можно вызывать из любого потока
+        void Stop();
+
+    private:
+        struct Task {
+            uint64_t connection_id = 0;
+            uint64_t sequence = 0;
+            std::string line;
+        };
+
+        struct Completion {
+            uint64_t connection_id = 0;
+            uint64_t sequence = 0;
+            std::string response;
+        };
+
+        struct Connection {
+            FileDescriptor fd;
+            // прочитанные байты, ещё не разобранные на строки
+            std::string input;
+            // номер следующей прочитанной строки и номер следующего ответа к отправке
+            uint64_t next_sequence = 0;
+            uint64_t next_to_send = 0;
+            // ответы, пришедшие раньше предыдущих по порядку
+            std::map<uint64_t, std::string> ready;
+            std::string output;
+            size_t output_pos = 0;
+            bool read_closed = false;
+            // ошибка сокета или слишком длинная строка: соединение закрывается без отправки оставшихся ответов
+            bool broken = false;
+            // события, на которые соединение подписано в epoll
+            uint32_t events = 0;
+        };
+
+        void WorkerLoop();
+        void PushTasks(std::vector<Task>& tasks);
+
+        void AcceptConnections();
+        void ReadConnection(uint64_t id, Connection& connection);
+        void WriteConnection(Connection& connection);
+        void DrainCompletions();
+        // переподписывает соединение в epoll или закрывает его, если оно больше не нужно
+        void UpdateConnection(uint64_t id);
+
+        RequestHandler& request_handler_;
+        ServerSettings settings_;
+
+        FileDescriptor listen_fd_;
+        FileDescriptor epoll_fd_;
+        FileDescriptor wake_fd_;
+        FileDescriptor signal_fd_;
+        // устройство и inode созданного файла сокета: при выходе удаляется только он
+        uint64_t socket_device_ = 0;
+        uint64_t socket_inode_ = 0;
+
+        std::unordered_map<uint64_t, Connection> connections_;
+        uint64_t next_connection_id_ = 0;
+
+        std::vector<std::thread> workers_;
+        std::mutex tasks_mutex_;
+        std::condition_variable tasks_cv_;
+        std::deque<Task> tasks_;
+        bool workers_stopping_ = false;
+
+        std::mutex completions_mutex_;
+        std::vector<Completion> completions_;
+
+        std::atomic<bool> stop_requested_ = false;
+    };
+
+    // отправляет серверу строки из input конвейером и выводит ответы в output по мере получения
+    // возвращается, когда сервер закрыл соединение, даже если input ещё не прочитан до конца: поток чтения
+    // input тогда остается работать до завершения процесса, поэтому input должен жить так же долго (как std::cin)
+    void RunClient(const std::string& socket_path, std::istream& input, std::ostream& output);
+
+} // namespace query_server
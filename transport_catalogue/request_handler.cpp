@@ -1,114 +1,517 @@
 #include "request_handler.h"
+#include "stats.h"
 
+#include <functional>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <tuple>
 
-void OutputStatRequests(transport_catalogue::TransportCatalogue& catalogue, std::vector<json::Node> doc_inf, RenderSettings settings_, std::pair<int, double> bus_setting) {
-    std::vector<json::Node> correct_requests;
+namespace {
 
-    transport_router::TransportRouter::RoutingSettings setting_bus_;
-    setting_bus_.wait_time = bus_setting.first;
-    setting_bus_.velocity = bus_setting.second* transport_router::KMH_TO_MMIN;
-    transport_router::TransportRouter router_graph(catalogue, setting_bus_);
-    //std::cout << "Settings bus "<<"\nSpeed " << router_graph.GetSettings().velocity << "\nTime " <<router_graph.GetSettings().wait_time << std::endl;
-    for (auto& node_inf : doc_inf) {
+    json::Node NotFound(int request_id, std::pmr::memory_resource* arena) {
+        return json::Builder{ arena }.StartDict().
+            Key("error_message").Value("not found").
+            Key("request_id").Value(request_id).
+            EndDict().Extract();
+    }
+
+    // Кэш напечатанных ответов на запросы одного типа по имени объекта (остановки или автобуса)
+    // такой ответ зависит только от каталога, поэтому хранится готовым текстом, в который при выводе подставляется request_id
+    // кэш сбрасывается при изменении каталога или настроек печати; после Freeze новые ответы в него не добавляются,
+    // и его можно читать из нескольких потоков
+    // место подстановки ищется по напечатанному ключу "request_id": в строках-значениях кавычка всегда экранирована,
+    // поэтому кавычка с двоеточием за именем ключа встречается только у самого ключа, как бы ни менялась длина
+    // остальных полей; текст ключа с разделителем зависит только от настроек печати и готовится один раз для них
+    class SerializedAnswerCache {
+    public:
+        explicit SerializedAnswerCache(const transport_catalogue::TransportCatalogue& catalogue) : catalogue_(catalogue) {
+        }
+
+        // возвращает ответ из кэша, при промахе строит его через build(request_id, arena) и запоминает текст
+        // build возвращает nullopt, если объекта нет в каталоге, - такие ответы не кэшируются
+        template <typename Build>
+        std::optional<json::Node> Answer(const std::string& name, int request_id, const json::PrintOptions& options,
+            std::pmr::memory_resource* arena, Build build) {
+            if (!IsValidFor(options)) {
+                if (frozen_) {
+                    return build(request_id, arena);
+                }
+                answers_.clear();
+                version_ = catalogue_.GetVersion();
+                options_ = options;
+                request_id_key_ = PrintRequestIdKey(options);
+            }
+            if (auto it = answers_.find(name); it != answers_.end()) {
+                return json::Node(it->second.WithSpliceValue(request_id));
+            }
+            if (frozen_) {
+                return build(request_id, arena);
+            }
+
+            std::optional<json::Node> answer = build(0, arena);
+            if (!answer) {
+                return std::nullopt;
+            }
+            std::string text = PrintAnswer(std::move(*answer), options);
+            const size_t key_pos = text.find(request_id_key_);
+            const size_t splice_pos = key_pos == std::string::npos ? text.size() : key_pos + request_id_key_.size();
+            if (splice_pos >= text.size() || text[splice_pos] != '0') {
+                throw std::logic_error("Cached answer has no request_id");
+            }
+            text.erase(splice_pos, 1);
+
+            auto [it, inserted] = answers_.emplace(name, json::RawJson(std::make_shared<const std::string>(std::move(text)), splice_pos, 0));
+            return json::Node(it->second.WithSpliceValue(request_id));
+        }
+
+        void Freeze() {
+            frozen_ = true;
+        }
+
+    private:
+        // ключ так, как его печатает словарь с данными настройками, вместе с разделителем перед значением
+        static std::string PrintRequestIdKey(const json::PrintOptions& options) {
+            std::ostringstream out;
+            json::PrintString("request_id", out);
+            out << (options.compact ? ":" : ": ");
+            return out.str();
+        }
+
+        static std::string PrintAnswer(json::Node answer, const json::PrintOptions& options) {
+            std::ostringstream out;
+            json::Print(json::Document{ std::move(answer) }, out, options);
+            return out.str();
+        }
+
+        bool IsValidFor(const json::PrintOptions& options) const {
+            return version_ == catalogue_.GetVersion() && options_.compact == options.compact
+                && options_.shortest_round_trip == options.shortest_round_trip;
+        }
+
+        const transport_catalogue::TransportCatalogue& catalogue_;
+        std::unordered_map<std::string, json::RawJson> answers_;
+        uint64_t version_ = 0;
+        json::PrintOptions options_;
+        std::string request_id_key_;
+        bool frozen_ = false;
+    };
+
+    //если запрос это остановка
+    class StopRequestHandler final : public StatRequestHandler {
+    public:
+        StopRequestHandler(const transport_catalogue::TransportCatalogue& catalogue, bool cache_answers)
+            : catalogue_(catalogue), cache_answers_(cache_answers), answers_(catalogue) {
+        }
+
+        void Prepare(const json::PrintOptions& options) override {
+            if (!cache_answers_) {
+                return;
+            }
+            std::pmr::monotonic_buffer_resource arena;
+            for (const auto& [name, stop] : catalogue_.GetStops()) {
+                answers_.Answer(stop->name, 0, options, &arena, [this, &stop = stop](int request_id, std::pmr::memory_resource* arena) {
+                    return BuildAnswer(stop->name, request_id, arena);
+                });
+                arena.release();
+            }
+            answers_.Freeze();
+        }
+
+        json::Node Answer(const StatRequest& stat_request, const json::PrintOptions& options, std::pmr::memory_resource* arena) override {
+            const auto& request = std::get<StopRequest>(stat_request);
+            auto build = [this, &request](int request_id, std::pmr::memory_resource* arena) {
+                return BuildAnswer(request.name, request_id, arena);
+            };
+            std::optional<json::Node> answer = cache_answers_
+                ? answers_.Answer(request.name, request.id, options, arena, build)
+                : build(request.id, arena);
+            return answer ? std::move(*answer) : NotFound(request.id, arena);
+        }
 
-        //если запрос это остановка
-        if (*(&(&node_inf.AsMap())->at("type").AsString()) == "Stop") {
-            std::string name = *(&(&node_inf.AsMap())->at("name").AsString());
+    private:
+        std::optional<json::Node> BuildAnswer(const std::string& stop_name, int request_id, std::pmr::memory_resource* arena) const {
             try {
-                catalogue.GetBusesOnStop(name);
-                std::vector<json::Node> all_buses;
-                for (auto& bus : catalogue.GetBusesOnStop(name)) {
-                    all_buses.push_back(json::Builder{}.Value(static_cast<std::string>(bus)).Build());
+                json::Array all_buses(arena);
+                for (auto& bus : catalogue_.GetBusesOnStop(stop_name)) {
+                    all_buses.push_back(json::Builder{ arena }.Value(static_cast<std::string>(bus)).Extract());
                 }
-                correct_requests.push_back(json::Builder{}.StartDict().
+                return json::Builder{ arena }.StartDict().
                     Key("buses").Value(std::move(all_buses)).
-                    Key("request_id").Value((&node_inf.AsMap())->at("id").AsInt()).
-                    EndDict().Build());
+                    Key("request_id").Value(request_id).
+                    EndDict().Extract();
             }
             catch (...) {
-                correct_requests.push_back(json::Builder{}.StartDict().
-                    Key("error_message").Value("not found").
-                    Key("request_id").Value((&node_inf.AsMap())->at("id").AsInt()).
-                    EndDict().Build());
+                return std::nullopt;
+            }
+        }
+
+        const transport_catalogue::TransportCatalogue& catalogue_;
+        bool cache_answers_;
+        SerializedAnswerCache answers_;
+    };
+
+    //если запрос это автобус
+    class BusRequestHandler final : public StatRequestHandler {
+    public:
+        BusRequestHandler(const transport_catalogue::TransportCatalogue& catalogue, bool cache_answers)
+            : catalogue_(catalogue), cache_answers_(cache_answers), answers_(catalogue) {
+        }
+
+        void Prepare(const json::PrintOptions& options) override {
+            catalogue_.PrecomputeRouteInfos();
+            if (!cache_answers_) {
+                return;
+            }
+            std::pmr::monotonic_buffer_resource arena;
+            for (const auto& [name, route] : catalogue_.GetRoutes()) {
+                answers_.Answer(route->name, 0, options, &arena, [this, &route = route](int request_id, std::pmr::memory_resource* arena) {
+                    return BuildAnswer(route->name, request_id, arena);
+                });
+                arena.release();
             }
+            answers_.Freeze();
         }
 
-        //если запрос это автобус
-        if (*(&(&node_inf.AsMap())->at("type").AsString()) == "Bus") {
-            std::string name = *(&(&node_inf.AsMap())->at("name").AsString());
+        json::Node Answer(const StatRequest& stat_request, const json::PrintOptions& options, std::pmr::memory_resource* arena) override {
+            const auto& request = std::get<BusRequest>(stat_request);
+            auto build = [this, &request](int request_id, std::pmr::memory_resource* arena) {
+                return BuildAnswer(request.name, request_id, arena);
+            };
+            std::optional<json::Node> answer = cache_answers_
+                ? answers_.Answer(request.name, request.id, options, arena, build)
+                : build(request.id, arena);
+            return answer ? std::move(*answer) : NotFound(request.id, arena);
+        }
+
+    private:
+        std::optional<json::Node> BuildAnswer(const std::string& route_name, int request_id, std::pmr::memory_resource* arena) const {
             try {
-                catalogue.GetRouteInfo(name);
-                correct_requests.push_back(json::Builder{}.StartDict().
-                    Key("request_id").Value((&node_inf.AsMap())->at("id").AsInt()).
-                    Key("curvature").Value(catalogue.GetRouteInfo(name).curvature).
-                    Key("route_length").Value(catalogue.GetRouteInfo(name).route_length).
-                    Key("stop_count").Value(catalogue.GetRouteInfo(name).num_of_stops).
-                    Key("unique_stop_count").Value(catalogue.GetRouteInfo(name).num_of_unique_stops).
-                    EndDict().Build());
+                RouteInfo route_info = catalogue_.GetRouteInfo(route_name);
+                return json::Builder{ arena }.StartDict().
+                    Key("request_id").Value(request_id).
+                    Key("curvature").Value(route_info.curvature).
+                    Key("route_length").Value(route_info.route_length).
+                    Key("stop_count").Value(route_info.num_of_stops).
+                    Key("unique_stop_count").Value(route_info.num_of_unique_stops).
+                    EndDict().Extract();
             }
             catch (...) {
-                correct_requests.push_back(json::Builder{}.StartDict().
-                    Key("error_message").Value("not found").
-                    Key("request_id").Value((&node_inf.AsMap())->at("id").AsInt()).
-                    EndDict().Build());
-            }
-        }
-
-        //если запрос это параметры карты
-        if (*(&(&node_inf.AsMap())->at("type").AsString()) == "Map") {
-            RenderSettings rend_set = settings_;
-            std::ostringstream ss;
-            MapRenderer map_rend;
-            map_rend.SetSettings(rend_set);
-            svg::Document svg_doc = map_rend.RenderMap(catalogue);
-            svg_doc.Render(ss);
-            correct_requests.push_back(json::Builder{}.StartDict().
-                Key("request_id").Value((&node_inf.AsMap())->at("id").AsInt()).
-                Key("map").Value(ss.str()).
-                EndDict().Build());
-        }
-        if (*(&(&node_inf.AsMap())->at("type").AsString()) == "Route") {
-            std::string from_stop = *(&(&node_inf.AsMap())->at("from").AsString());
-            std::string to_stop= *(&(&node_inf.AsMap())->at("to").AsString());
-            std::optional<std::vector<transport_router::TransportRouter::RouterEdge>> marshrut=router_graph.BuildRoute(from_stop, to_stop);
-            //std::cout << "Otvet marshruta "<< (&node_inf.AsMap())->at("id").AsInt() << std::endl;
-            std::vector<json::Node> all_rout;
-
-            if (marshrut.has_value()) {
-                double total_time = 0;
-                for (auto znak : marshrut.value()) {
-                    //std::cout << "{" << std::endl;
-                    //std::cout << znak.stop_from << "\n" << setting_bus_.wait_time<<"\n" << znak.bus_name << "\n" << znak.span_count << "\n" << znak.total_time << "\n";
-                    //std::cout << znak.bus_name << "\n" << znak.span_count << "\n" << znak.total_time << "\n";
-                    //std::cout << "}" << std::endl;
-                    all_rout.push_back(json::Builder{}.StartDict().
-                        Key("stop_name").Value(static_cast<std::string>(znak.stop_from)).
-                        Key("time").Value(setting_bus_.wait_time).
-                        Key("type").Value("Wait").EndDict().Build());
-                    all_rout.push_back(json::Builder{}.StartDict().
-                        Key("bus").Value(static_cast<std::string>(znak.bus_name)).
-                        Key("span_count").Value(znak.span_count).
-                        Key("time").Value(znak.total_time - setting_bus_.wait_time).
-                        Key("type").Value("Bus").EndDict().Build());
-                    total_time += znak.total_time;
+                return std::nullopt;
+            }
+        }
+
+        const transport_catalogue::TransportCatalogue& catalogue_;
+        bool cache_answers_;
+        SerializedAnswerCache answers_;
+    };
+
+    //если запрос это параметры карты
+    // карта зависит только от геометрии каталога (маршруты и координаты их остановок) и от настроек,
+    // которые задаются один раз при создании, поэтому её SVG хранится уже экранированной строкой JSON:
+    // повторный запрос при неизменной геометрии копирует готовый текст в вывод
+    class MapRequestHandler final : public StatRequestHandler {
+    public:
+        MapRequestHandler(const transport_catalogue::TransportCatalogue& catalogue, const RenderSettings& settings) : catalogue_(catalogue) {
+            // настройки (вместе с палитрой) копируются один раз, а не на каждый запрос
+            map_renderer_.SetSettings(settings);
+        }
+
+        void Prepare(const json::PrintOptions&) override {
+            map_renderer_.UpdateFieldSize(catalogue_);
+            GetRenderedMap();
+        }
+
+        json::Node Answer(const StatRequest& stat_request, const json::PrintOptions&, std::pmr::memory_resource* arena) override {
+            const auto& request = std::get<MapRequest>(stat_request);
+            return json::Builder{ arena }.StartDict().
+                Key("map").Value(json::RawJson(GetRenderedMap())).
+                Key("request_id").Value(request.id).
+                EndDict().Extract();
+        }
+
+    private:
+        // карта перерисовывается, только если изменились маршруты или координаты остановок на них;
+        // изменения расстояний и остановок без маршрутов на карту не влияют
+        std::shared_ptr<const std::string> GetRenderedMap() {
+            const uint64_t version = catalogue_.GetGeometryVersion();
+            if (!rendered_map_ || rendered_version_ != version) {
+                [[maybe_unused]] stats::ScopedTimer timer(stats::Phase::RENDER_MAP);
+                std::ostringstream svg_text;
+                map_renderer_.RenderMap(catalogue_, svg_text);
+                std::ostringstream json_text;
+                json::PrintString(svg_text.str(), json_text);
+                rendered_map_ = std::make_shared<const std::string>(json_text.str());
+                rendered_version_ = version;
+            }
+            return rendered_map_;
+        }
+
+        const transport_catalogue::TransportCatalogue& catalogue_;
+        MapRenderer map_renderer_;
+
+        std::shared_ptr<const std::string> rendered_map_;
+        uint64_t rendered_version_ = 0;
+    };
+
+    //если запрос это маршрут
+    class RouteRequestHandler final : public StatRequestHandler {
+    public:
+        RouteRequestHandler(const transport_catalogue::TransportCatalogue& catalogue, const transport_router::TransportRouter::RoutingSettings& settings)
+            : router_graph_(catalogue, settings) {
+        }
+
+        void Prepare(const json::PrintOptions&) override {
+            router_graph_.InitRouter();
+        }
+
+        json::Node Answer(const StatRequest& stat_request, const json::PrintOptions&, std::pmr::memory_resource* arena) override {
+            const auto& request = std::get<RouteRequest>(stat_request);
+            const auto& setting_bus_ = router_graph_.GetSettings();
+            std::optional<std::vector<transport_router::TransportRouter::RouterEdge>> marshrut = router_graph_.BuildRoute(request.from, request.to);
+            if (!marshrut.has_value()) {
+                return NotFound(request.id, arena);
+            }
+
+            json::Array all_rout(arena);
+            double total_time = 0;
+            for (auto znak : marshrut.value()) {
+                all_rout.push_back(json::Builder{ arena }.StartDict().
+                    Key("stop_name").Value(static_cast<std::string>(znak.stop_from)).
+                    Key("time").Value(setting_bus_.wait_time).
+                    Key("type").Value("Wait").EndDict().Extract());
+                all_rout.push_back(json::Builder{ arena }.StartDict().
+                    Key("bus").Value(static_cast<std::string>(znak.bus_name)).
+                    Key("span_count").Value(znak.span_count).
+                    Key("time").Value(znak.total_time - setting_bus_.wait_time).
+                    Key("type").Value("Bus").EndDict().Extract());
+                total_time += znak.total_time;
+            }
+
+            return json::Builder{ arena }.StartDict().
+                Key("items").Value(std::move(all_rout)).
+                Key("request_id").Value(request.id).
+                Key("total_time").Value(total_time).
+                EndDict().Extract();
+        }
+
+    private:
+        // маршрутизатор строится один раз при первом запросе маршрута и живет вместе с обработчиком
+        transport_router::TransportRouter router_graph_;
+    };
+
+    // ключ запроса без его id: запросы с равными ключами получают одинаковый ответ
+    struct RequestKey {
+        RequestType type;
+        std::string_view first;
+        std::string_view second;
+
+        bool operator==(const RequestKey& other) const {
+            return std::tie(type, first, second) == std::tie(other.type, other.first, other.second);
+        }
+    };
+
+    struct RequestKeyHasher {
+        size_t operator()(const RequestKey& key) const noexcept {
+            const std::hash<std::string_view> hasher;
+            return hasher(key.first) * 37 + hasher(key.second) * 37 * 37 + static_cast<size_t>(key.type);
+        }
+    };
+
+    RequestKey GetRequestKey(const StatRequest& request) {
+        switch (GetRequestType(request)) {
+        case RequestType::STOP:
+            return { RequestType::STOP, std::get<StopRequest>(request).name, {} };
+        case RequestType::BUS:
+            return { RequestType::BUS, std::get<BusRequest>(request).name, {} };
+        case RequestType::MAP:
+            return { RequestType::MAP, {}, {} };
+        case RequestType::ROUTE:
+            return { RequestType::ROUTE, std::get<RouteRequest>(request).from, std::get<RouteRequest>(request).to };
+        }
+        return { GetRequestType(request), {}, {} };
+    }
+
+    // план выполнения пакета запросов
+    struct BatchPlan {
+        // для каждого запроса пакета - номер уникального запроса, ответ на который ему подходит
+        std::vector<size_t> unique_index;
+        // для каждого уникального запроса - номер первого такого запроса в пакете, он и выполняется
+        // уникальные запросы идут в порядке первого появления в пакете
+        std::vector<size_t> representatives;
+        // для каждого уникального запроса - сколько раз он встречается в пакете
+        std::vector<size_t> use_counts;
+    };
+
+    // ответы выводятся сразу по мере вычисления, поэтому уникальные запросы выполняются в порядке пакета,
+    // а не сгруппированными по типу и начальной остановке: группировка потребовала бы держать в памяти ответы
+    // всех запросов, выполненных раньше своей очереди на вывод
+    BatchPlan PlanBatch(const std::vector<StatRequest>& requests) {
+        [[maybe_unused]] stats::ScopedTimer timer(stats::Phase::PLAN_BATCH);
+        BatchPlan plan;
+        plan.unique_index.reserve(requests.size());
+        std::unordered_map<RequestKey, size_t, RequestKeyHasher> unique_by_key;
+        unique_by_key.reserve(requests.size());
+        for (size_t i = 0; i < requests.size(); ++i) {
+            const RequestKey key = GetRequestKey(requests[i]);
+            const auto [it, inserted] = unique_by_key.emplace(key, plan.representatives.size());
+            if (inserted) {
+                plan.representatives.push_back(i);
+                plan.use_counts.push_back(0);
+            }
+            else if constexpr (stats::ENABLED) {
+                if (key.type == RequestType::ROUTE) {
+                    stats::RecordRouteDuplicate();
                 }
-                
-                correct_requests.push_back(json::Builder{}.StartDict().
-                    Key("items").Value(all_rout).
-                    Key("request_id").Value((&node_inf.AsMap())->at("id").AsInt()).
-                    Key("total_time").Value(total_time).
-                    EndDict().Build());
             }
-            else {
-                correct_requests.push_back(json::Builder{}.StartDict().
-                    Key("error_message").Value("not found").
-                    Key("request_id").Value((&node_inf.AsMap())->at("id").AsInt()).
-                    EndDict().Build());
+            plan.unique_index.push_back(it->second);
+            ++plan.use_counts[it->second];
+        }
+        return plan;
+    }
+
+    // копия узла, все массивы и словари которой размещены в arena: обычная копия ушла бы в ресурс по умолчанию
+    json::Node CopyToArena(const json::Node& node, std::pmr::memory_resource* arena) {
+        if (node.IsArray()) {
+            json::Array result(arena);
+            result.reserve(node.AsArray().size());
+            for (const auto& item : node.AsArray()) {
+                result.push_back(CopyToArena(item, arena));
+            }
+            return json::Node(std::move(result));
+        }
+        if (node.IsMap()) {
+            json::Dict result(arena);
+            result.reserve(node.AsMap().size());
+            for (const auto& [key, value] : node.AsMap()) {
+                result.insert({ key, CopyToArena(value, arena) });
             }
+            return json::Node(std::move(result));
+        }
+        return node;
+    }
+
+    // копия ответа с другим request_id - для повторов одного и того же запроса, размещается в arena
+    json::Node WithRequestId(const json::Node& answer, int request_id, std::pmr::memory_resource* arena) {
+        // в напечатанный заранее ответ request_id подставляется при выводе
+        if (answer.IsRaw()) {
+            return json::Node(answer.AsRaw().WithSpliceValue(request_id));
+        }
+        json::Dict result(arena);
+        result.reserve(answer.AsMap().size());
+        for (const auto& [key, value] : answer.AsMap()) {
+            result.insert({ key, key == "request_id" ? json::Node(request_id) : CopyToArena(value, arena) });
+        }
+        return json::Node(std::move(result));
+    }
 
+} // namespace
+
+RequestHandler::RequestHandler(const transport_catalogue::TransportCatalogue& catalogue, const RenderSettings& render_settings,
+    const transport_router::TransportRouter::RoutingSettings& routing_settings, bool cache_answers) {
+    RegisterHandler(RequestType::STOP, std::make_unique<StopRequestHandler>(catalogue, cache_answers));
+    RegisterHandler(RequestType::BUS, std::make_unique<BusRequestHandler>(catalogue, cache_answers));
+    RegisterHandler(RequestType::MAP, std::make_unique<MapRequestHandler>(catalogue, render_settings));
+    RegisterHandler(RequestType::ROUTE, std::make_unique<RouteRequestHandler>(catalogue, routing_settings));
+}
+
+void RequestHandler::RegisterHandler(RequestType type, std::unique_ptr<StatRequestHandler> handler) {
+    handlers_.at(static_cast<size_t>(type)) = std::move(handler);
+}
+
+void RequestHandler::Prepare(const json::PrintOptions& options) {
+    for (auto& handler : handlers_) {
+        if (handler) {
+            handler->Prepare(options);
         }
+    }
+}
 
+json::Node RequestHandler::Answer(const StatRequest& request, const json::PrintOptions& options, std::pmr::memory_resource* arena) {
+    // тип запроса уже определен при разборе, обработчик выбирается по индексу без сравнения строк
+    const RequestType type = GetRequestType(request);
+    [[maybe_unused]] stats::ScopedTimer timer(type);
+    const auto& handler = handlers_[static_cast<size_t>(type)];
+    if (!handler) {
+        throw std::logic_error("No handler registered for request type");
     }
+    return handler->Answer(request, options, arena);
+}
 
-    json::Print(json::Document{ json::Builder{}.Value(correct_requests).Build() }, std::cout);
+void RequestHandler::OutputStatRequests(const std::vector<StatRequest>& requests, std::ostream& output, const json::PrintOptions& options) {
+    // повторяющиеся запросы выполняются один раз: повтор получает копию ответа первого такого запроса
+    const BatchPlan plan = PlanBatch(requests);
+
+    // ответы выводятся в исходном порядке сразу по мере вычисления: узлы ответа живут в арене до его вывода
+    // и освобождаются разом, в памяти остаются только ответы, которые ещё понадобятся повторам
+    [[maybe_unused]] stats::ScopedTimer timer(stats::Phase::ANSWER_REQUESTS);
+    std::pmr::monotonic_buffer_resource answer_arena;
+    std::pmr::monotonic_buffer_resource reused_arena;
+    std::vector<json::Node> reused_answers(plan.representatives.size());
+    std::vector<size_t> remaining_uses = plan.use_counts;
+    json::ArrayWriter correct_requests(output, options);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const size_t unique = plan.unique_index[i];
+        --remaining_uses[unique];
+        if (plan.representatives[unique] == i) {
+            if (remaining_uses[unique] == 0) {
+                correct_requests.Write(Answer(requests[i], options, &answer_arena));
+                answer_arena.release();
+            }
+            else {
+                reused_answers[unique] = Answer(requests[i], options, &reused_arena);
+                correct_requests.Write(reused_answers[unique]);
+            }
+        }
+        else {
+            correct_requests.Write(WithRequestId(reused_answers[unique], GetRequestId(requests[i]), &answer_arena));
+            answer_arena.release();
+            // последний повтор - узел больше не нужен
+            if (remaining_uses[unique] == 0) {
+                reused_answers[unique] = json::Node{};
+            }
+        }
+    }
+
+    correct_requests.Finish();
+}
+
+void RequestHandler::AnswerLine(std::string_view line, std::ostream& output, std::pmr::memory_resource* arena) {
+    const json::PrintOptions& options = LINE_PRINT_OPTIONS;
+
+    json::Node answer;
+    try {
+        if (auto request = JsonReader{}.ReadStatRequest(json::Load(line, arena).GetRoot())) {
+            answer = Answer(*request, options, arena);
+        }
+    }
+    catch (const std::exception&) {
+        // некорректная строка или запрос к несуществующим данным не прерывает работу, на него выводится ошибка
+    }
+    if (answer.IsNull()) {
+        answer = json::Builder{ arena }.StartDict().
+            Key("error_message").Value("invalid request").
+            EndDict().Extract();
+    }
+    json::Print(json::Document{ std::move(answer) }, output, options);
+    output.put('\n');
+}
+
+void RequestHandler::ServeNdjson(std::istream& input, std::ostream& output) {
+    [[maybe_unused]] stats::ScopedTimer timer(stats::Phase::ANSWER_REQUESTS);
+    std::pmr::monotonic_buffer_resource request_arena;
+    std::string line;
+    while (std::getline(input, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        AnswerLine(line, output, &request_arena);
+        request_arena.release();
+        // сбрасываем вывод, когда все уже прочитанные запросы обработаны, чтобы отвечать пачками, а не на каждой строке
+        if (input.rdbuf()->in_avail() <= 0) {
+            output.flush();
+        }
+    }
+    output.flush();
 }
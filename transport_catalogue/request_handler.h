@@ -1,4 +1,61 @@
 #pragma once
 #include "json_reader.h"
 #include "transport_router.h"
-void OutputStatRequests(transport_catalogue::TransportCatalogue& catalogue, std::vector<json::Node> doc_inf, RenderSettings settings_,std::pair<int,double> bus_setting);
+
+#include <array>
+#include <memory>
+
+// обработчик запросов одного типа, владеет состоянием, которое нужно для ответа и живет между запросами
+// (маршрутизатор, отрисовщик карты)
+class StatRequestHandler {
+public:
+    virtual ~StatRequestHandler() = default;
+
+    // заранее заполняет ленивые кэши для ответов, печатаемых с options: после этого Answer только читает
+    // состояние обработчика и каталога и может вызываться из нескольких потоков, пока каталог не изменяется
+    virtual void Prepare(const json::PrintOptions&) {
+    }
+
+    // request всегда того типа, для которого обработчик зарегистрирован; узлы ответа размещаются в arena
+    // options - с какими настройками ответ будет напечатан: ответ может содержать заранее напечатанные с ними фрагменты (json::RawJson)
+    virtual json::Node Answer(const StatRequest& request, const json::PrintOptions& options, std::pmr::memory_resource* arena) = 0;
+};
+
+// отвечает на запросы к каталогу, выбирая обработчик по типу запроса из таблицы
+// для нового типа запроса достаточно добавить его в RequestType и StatRequest и зарегистрировать обработчик
+class RequestHandler {
+public:
+    // настройки печати ответов AnswerLine: одна строка на ответ
+    static constexpr json::PrintOptions LINE_PRINT_OPTIONS{ false, true };
+
+    // регистрирует обработчики всех известных типов запросов; каталог должен жить дольше RequestHandler
+    // cache_answers - хранить ответы на запросы Stop и Bus напечатанными и при повторе только подставлять request_id;
+    // окупается для долгоживущих обработчиков (NDJSON, сервер), в пакетном режиме повторы и так отвечаются один раз
+    RequestHandler(const transport_catalogue::TransportCatalogue& catalogue, const RenderSettings& render_settings,
+        const transport_router::TransportRouter::RoutingSettings& routing_settings, bool cache_answers = false);
+
+    // заменяет обработчик запросов данного типа
+    void RegisterHandler(RequestType type, std::unique_ptr<StatRequestHandler> handler);
+
+    // готовит все обработчики к ответам из нескольких потоков (см. StatRequestHandler::Prepare)
+    void Prepare(const json::PrintOptions& options);
+
+    // отвечает на один запрос, который будет напечатан с options; узлы ответа размещаются в arena
+    json::Node Answer(const StatRequest& request, const json::PrintOptions& options, std::pmr::memory_resource* arena);
+
+    // ответы выводятся в output массивом JSON в порядке запросов, options задает формат вывода (по умолчанию - с отступами)
+    // одинаковые запросы пакета (отличающиеся только id) выполняются один раз; ответы выводятся по мере вычисления,
+    // и в памяти держатся только те, которые ещё понадобятся повторам
+    void OutputStatRequests(const std::vector<StatRequest>& requests, std::ostream& output = std::cout, const json::PrintOptions& options = {});
+
+    // отвечает на запрос, записанный одной строкой JSON, и выводит ответ одной строкой с переводом строки в конце
+    // на некорректную строку или запрос неизвестного типа выводится {"error_message":"invalid request"}
+    void AnswerLine(std::string_view line, std::ostream& output, std::pmr::memory_resource* arena);
+
+    // режим долгоживущего процесса: каталог уже загружен, запросы приходят из input по одному JSON-объекту на строку (NDJSON)
+    // на каждую непустую строку выводится одна строка ответа; вывод сбрасывается, когда прочитанные строки закончились
+    void ServeNdjson(std::istream& input, std::ostream& output);
+
+private:
+    std::array<std::unique_ptr<StatRequestHandler>, REQUEST_TYPE_COUNT> handlers_;
+};
@@ -14,7 +14,8 @@
 
 namespace graph {
 
-template <typename Weight>
+// CollectStats включает подсчет работы при построении; без него счетчики не ведутся и ничего не стоят
+template <typename Weight, bool CollectStats = false>
 class Router {
 private:
     using Graph = DirectedWeightedGraph<Weight>;
@@ -27,8 +28,24 @@ public:
         std::vector<EdgeId> edges;
     };
 
+    // работа, проделанная при построении таблицы кратчайших путей
+    struct BuildStats {
+        size_t vertex_count = 0;
+        size_t edge_count = 0;
+        // сколько раз путь через промежуточную вершину сравнивался с известным и сколько раз оказался короче
+        uint64_t relax_checks = 0;
+        uint64_t relax_improvements = 0;
+        // число упорядоченных пар вершин, между которыми есть путь
+        uint64_t reachable_pairs = 0;
+    };
+
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+    // заполнена только при CollectStats
+    const BuildStats& GetBuildStats() const {
+        return build_stats_;
+    }
+
 private:
     struct RouteInternalData {
         Weight weight;
@@ -57,7 +74,13 @@ private:
                     const RouteInternalData& route_to) {
         auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
         const Weight candidate_weight = route_from.weight + route_to.weight;
+        if constexpr (CollectStats) {
+            ++build_stats_.relax_checks;
+        }
         if (!route_relaxing || candidate_weight < route_relaxing->weight) {
+            if constexpr (CollectStats) {
+                ++build_stats_.relax_improvements;
+            }
             route_relaxing = {candidate_weight,
                               route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
         }
@@ -75,13 +98,21 @@ private:
         }
     }
 
+    void CountReachablePairs() {
+        for (const auto& routes_from : routes_internal_data_) {
+            build_stats_.reachable_pairs += static_cast<uint64_t>(std::count_if(routes_from.begin(), routes_from.end(),
+                [](const auto& route) { return route.has_value(); }));
+        }
+    }
+
     static constexpr Weight ZERO_WEIGHT{};
     const Graph& graph_;
     RoutesInternalData routes_internal_data_;
+    BuildStats build_stats_;
 };
 
-template <typename Weight>
-Router<Weight>::Router(const Graph& graph)
+template <typename Weight, bool CollectStats>
+Router<Weight, CollectStats>::Router(const Graph& graph)
     : graph_(graph)
     , routes_internal_data_(graph.GetVertexCount(),
                             std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
@@ -92,11 +123,17 @@ Router<Weight>::Router(const Graph& graph)
     for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
         RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
     }
+
+    if constexpr (CollectStats) {
+        build_stats_.vertex_count = vertex_count;
+        build_stats_.edge_count = graph.GetEdgeCount();
+        CountReachablePairs();
+    }
 }
 
-template <typename Weight>
-std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
-                                                                             VertexId to) const {
+template <typename Weight, bool CollectStats>
+std::optional<typename Router<Weight, CollectStats>::RouteInfo> Router<Weight, CollectStats>::BuildRoute(VertexId from,
+                                                                                                         VertexId to) const {
     const auto& route_internal_data = routes_internal_data_.at(from).at(to);
     if (!route_internal_data) {
         return std::nullopt;
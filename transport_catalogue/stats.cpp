@@ -0,0 +1,261 @@
+#include "stats.h"
+
+#include "json_builder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
+namespace stats {
+
+    using namespace std::literals;
+
+    namespace {
+
+        constexpr std::array<std::string_view, PHASE_COUNT> PHASE_NAMES = {
+            "load_base"sv,
+            "read_stat_requests"sv,
+            "plan_batch"sv,
+            "answer_requests"sv,
+            "init_router"sv,
+            "render_map"sv,
+        };
+
+        // имена совпадают со значением поля "type" запроса
+        constexpr std::array<std::string_view, REQUEST_TYPE_COUNT> REQUEST_NAMES = {
+            "Stop"sv,
+            "Bus"sv,
+            "Map"sv,
+            "Route"sv,
+        };
+
+        std::array<LatencyHistogram, PHASE_COUNT> phase_histograms;
+        std::array<LatencyHistogram, REQUEST_TYPE_COUNT> request_histograms;
+
+        // суммы приростов аппаратных счетчиков по фазам и число замеров, в которых счетчик был доступен
+        struct PhasePerfTotals {
+            std::array<std::atomic<uint64_t>, PERF_EVENT_COUNT> values{};
+            std::array<std::atomic<uint64_t>, PERF_EVENT_COUNT> samples{};
+        };
+        std::array<PhasePerfTotals, PHASE_COUNT> phase_perf_totals;
+
+        struct RouterTotals {
+            std::atomic<uint64_t> builds = 0;
+            // итоги последнего построения
+            std::atomic<uint64_t> vertex_count = 0;
+            std::atomic<uint64_t> edge_count = 0;
+            std::atomic<uint64_t> relax_checks = 0;
+            std::atomic<uint64_t> relax_improvements = 0;
+            std::atomic<uint64_t> reachable_pairs = 0;
+
+            std::array<std::atomic<uint64_t>, 3> outcomes{};
+            std::atomic<uint64_t> batch_duplicates = 0;
+            // распределение длины найденных путей в ребрах
+            LatencyHistogram path_edges;
+        };
+        RouterTotals router_totals;
+
+        double ToCount(const std::atomic<uint64_t>& counter) {
+            return static_cast<double>(counter.load(std::memory_order_relaxed));
+        }
+
+        json::Node DescribeRouter() {
+            const RouterTotals& totals = router_totals;
+            const LatencyHistogram& path_edges = totals.path_edges;
+            return json::Builder{}.StartDict().
+                Key("builds").Value(ToCount(totals.builds)).
+                Key("vertex_count").Value(ToCount(totals.vertex_count)).
+                Key("edge_count").Value(ToCount(totals.edge_count)).
+                Key("relax_checks").Value(ToCount(totals.relax_checks)).
+                Key("relax_improvements").Value(ToCount(totals.relax_improvements)).
+                Key("reachable_pairs").Value(ToCount(totals.reachable_pairs)).
+                Key("queries").StartDict().
+                    Key("found").Value(ToCount(totals.outcomes[static_cast<size_t>(RouteOutcome::FOUND)])).
+                    Key("not_found").Value(ToCount(totals.outcomes[static_cast<size_t>(RouteOutcome::NOT_FOUND)])).
+                    Key("same_stop").Value(ToCount(totals.outcomes[static_cast<size_t>(RouteOutcome::SAME_STOP)])).
+                    Key("batch_duplicates").Value(ToCount(totals.batch_duplicates)).
+                    Key("path_edges").StartDict().
+                        Key("total").Value(static_cast<double>(path_edges.GetTotal())).
+                        Key("p50").Value(static_cast<double>(path_edges.GetPercentile(0.5))).
+                        Key("p99").Value(static_cast<double>(path_edges.GetPercentile(0.99))).
+                        Key("max").Value(static_cast<double>(path_edges.GetMax())).
+                    EndDict().
+                EndDict().
+                EndDict().Extract();
+        }
+
+        double ToMicroseconds(uint64_t nanoseconds) {
+            return static_cast<double>(nanoseconds) / 1000.0;
+        }
+
+        json::Node DescribePerf(const PhasePerfTotals& totals) {
+            json::Builder builder;
+            auto perf = builder.StartDict();
+            for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+                if (totals.samples[i].load(std::memory_order_relaxed) > 0) {
+                    // суммы счетчиков легко выходят за int, поэтому выводятся числом с плавающей точкой
+                    perf.Key(std::string(GetPerfEventName(static_cast<PerfEvent>(i)))).
+                        Value(static_cast<double>(totals.values[i].load(std::memory_order_relaxed)));
+                }
+            }
+            const auto cycles = totals.values[static_cast<size_t>(PerfEvent::CYCLES)].load(std::memory_order_relaxed);
+            const auto instructions = totals.values[static_cast<size_t>(PerfEvent::INSTRUCTIONS)].load(std::memory_order_relaxed);
+            if (cycles > 0 && totals.samples[static_cast<size_t>(PerfEvent::INSTRUCTIONS)].load(std::memory_order_relaxed) > 0) {
+                perf.Key("ipc").Value(static_cast<double>(instructions) / static_cast<double>(cycles));
+            }
+            perf.EndDict();
+            return builder.Extract();
+        }
+
+        // perf - суммы аппаратных счетчиков фазы, если они включены
+        json::Node DescribeHistogram(const LatencyHistogram& histogram, const PhasePerfTotals* perf = nullptr) {
+            json::Builder builder;
+            auto description = builder.StartDict().
+                Key("count").Value(static_cast<int>(std::min<uint64_t>(histogram.GetCount(), std::numeric_limits<int>::max()))).
+                Key("total_us").Value(ToMicroseconds(histogram.GetTotal())).
+                Key("min_us").Value(ToMicroseconds(histogram.GetMin())).
+                Key("p50_us").Value(ToMicroseconds(histogram.GetPercentile(0.5))).
+                Key("p99_us").Value(ToMicroseconds(histogram.GetPercentile(0.99))).
+                Key("p999_us").Value(ToMicroseconds(histogram.GetPercentile(0.999))).
+                Key("max_us").Value(ToMicroseconds(histogram.GetMax()));
+            if (perf != nullptr) {
+                description.Key("perf").Value(DescribePerf(*perf));
+            }
+            description.EndDict();
+            return builder.Extract();
+        }
+
+    } // namespace
+
+    // ------------------------ LatencyHistogram ------------------------
+
+    size_t LatencyHistogram::GetBucketIndex(uint64_t value) noexcept {
+        // значения меньше SUB_BUCKET_COUNT лежат каждое в своей корзине
+        if (value < SUB_BUCKET_COUNT) {
+            return static_cast<size_t>(value);
+        }
+        const unsigned highest_bit = 63 - static_cast<unsigned>(__builtin_clzll(value));
+        const unsigned shift = highest_bit - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKET_COUNT + static_cast<size_t>((value >> shift) - SUB_BUCKET_COUNT);
+    }
+
+    uint64_t LatencyHistogram::GetBucketUpperBound(size_t index) noexcept {
+        if (index < SUB_BUCKET_COUNT) {
+            return index;
+        }
+        const unsigned shift = static_cast<unsigned>(index / SUB_BUCKET_COUNT - 1);
+        const uint64_t lower_bound = static_cast<uint64_t>(index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT) << shift;
+        return lower_bound + ((uint64_t{ 1 } << shift) - 1);
+    }
+
+    void LatencyHistogram::Record(uint64_t nanoseconds) noexcept {
+        buckets_[GetBucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        total_.fetch_add(nanoseconds, std::memory_order_relaxed);
+        uint64_t min = min_.load(std::memory_order_relaxed);
+        while (nanoseconds < min && !min_.compare_exchange_weak(min, nanoseconds, std::memory_order_relaxed)) {
+        }
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        while (nanoseconds > max && !max_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t LatencyHistogram::GetCount() const noexcept {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t LatencyHistogram::GetTotal() const noexcept {
+        return total_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t LatencyHistogram::GetMin() const noexcept {
+        return GetCount() == 0 ? 0 : min_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t LatencyHistogram::GetMax() const noexcept {
+        return max_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t LatencyHistogram::GetPercentile(double quantile) const noexcept {
+        const uint64_t count = GetCount();
+        if (count == 0) {
+            return 0;
+        }
+        // номер замера, на который приходится перцентиль, считая с 1
+        const uint64_t rank = std::clamp<uint64_t>(static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(count))), 1, count);
+        uint64_t seen = 0;
+        for (size_t index = 0; index < BUCKET_COUNT; ++index) {
+            seen += buckets_[index].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return std::min(GetBucketUpperBound(index), GetMax());
+            }
+        }
+        return GetMax();
+    }
+
+    // --------------------------- статистика ---------------------------
+
+    void RecordPhase(Phase phase, uint64_t nanoseconds, const PerfSample& perf) noexcept {
+        phase_histograms[static_cast<size_t>(phase)].Record(nanoseconds);
+        PhasePerfTotals& totals = phase_perf_totals[static_cast<size_t>(phase)];
+        for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+            if (perf.available[i]) {
+                totals.values[i].fetch_add(perf.values[i], std::memory_order_relaxed);
+                totals.samples[i].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void RecordRequest(RequestType type, uint64_t nanoseconds) noexcept {
+        request_histograms[static_cast<size_t>(type)].Record(nanoseconds);
+    }
+
+    void RecordRouterBuild(const RouterBuildStats& build) noexcept {
+        RouterTotals& totals = router_totals;
+        totals.builds.fetch_add(1, std::memory_order_relaxed);
+        totals.vertex_count.store(build.vertex_count, std::memory_order_relaxed);
+        totals.edge_count.store(build.edge_count, std::memory_order_relaxed);
+        totals.relax_checks.store(build.relax_checks, std::memory_order_relaxed);
+        totals.relax_improvements.store(build.relax_improvements, std::memory_order_relaxed);
+        totals.reachable_pairs.store(build.reachable_pairs, std::memory_order_relaxed);
+    }
+
+    void RecordRouteQuery(RouteOutcome outcome, size_t path_edges) noexcept {
+        router_totals.outcomes[static_cast<size_t>(outcome)].fetch_add(1, std::memory_order_relaxed);
+        if (outcome == RouteOutcome::FOUND) {
+            router_totals.path_edges.Record(path_edges);
+        }
+    }
+
+    void RecordRouteDuplicate() noexcept {
+        router_totals.batch_duplicates.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void WriteJson(std::ostream& output) {
+        json::Builder builder;
+        auto root = builder.StartDict().Key("enabled").Value(ENABLED);
+        if constexpr (ENABLED) {
+            root.Key("perf_counters").Value(GetPerfStatus());
+            auto phases = root.Key("phases").StartDict();
+            for (size_t i = 0; i < PHASE_COUNT; ++i) {
+                phases.Key(std::string(PHASE_NAMES[i])).
+                    Value(DescribeHistogram(phase_histograms[i], IsPerfEnabled() ? &phase_perf_totals[i] : nullptr));
+            }
+            phases.EndDict();
+            auto requests = root.Key("requests").StartDict();
+            for (size_t i = 0; i < REQUEST_TYPE_COUNT; ++i) {
+                requests.Key(std::string(REQUEST_NAMES[i])).Value(DescribeHistogram(request_histograms[i]));
+            }
+            requests.EndDict();
+            root.Key("router").Value(DescribeRouter());
+        }
+        root.EndDict();
+        json::PrintOptions options;
+        options.shortest_round_trip = true;
+        json::Print(json::Document{ builder.Extract() }, output, options);
+        output << '\n';
+        output.flush();
+    }
+
+} // namespace stats
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "domain.h"
+#include "perf_counters.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+// Встроенная статистика времени работы: таймеры фаз (загрузка, ответы, построение маршрутизатора, отрисовка)
+// и гистограммы задержки ответов по типам запросов; при включенных EnablePerfCounters для фаз
+// дополнительно суммируются аппаратные счетчики процессора
+// фазы не пересекаются: фаза, начатая внутри другой (маршрутизатор и карта строятся при первом запросе к ним),
+// вычитает свое время и счетчики из объемлющей, поэтому сумма фаз равна общему времени под таймерами фаз;
+// задержка запроса, напротив, включает всё, что было сделано ради него
+// собирается только при сборке с -DTRANSPORT_CATALOGUE_STATS, иначе таймеры - пустые объекты и ничего не стоят
+namespace stats {
+
+#ifdef TRANSPORT_CATALOGUE_STATS
+    inline constexpr bool ENABLED = true;
+#else
+    inline constexpr bool ENABLED = false;
+#endif
+
+    enum class Phase {
+        LOAD_BASE,           // разбор входного документа вместе с заполнением каталога
+        READ_STAT_REQUESTS,  // раскладка stat_requests в типизированные запросы
+        PLAN_BATCH,          // планирование пакета запросов
+        ANSWER_REQUESTS,     // ответы на весь пакет запросов или весь поток NDJSON вместе с их печатью
+        INIT_ROUTER,         // построение графа и маршрутизатора
+        RENDER_MAP,          // отрисовка карты в SVG
+    };
+
+    inline constexpr size_t PHASE_COUNT = 6;
+
+    // Гистограмма длительностей в наносекундах с логарифмически-линейными корзинами (как HDR Histogram):
+    // каждый интервал [2^k, 2^(k+1)) делится на 32 корзины, поэтому ошибка перцентиля - не больше 1/32 значения
+    // запись без блокировок, её можно вести из нескольких потоков
+    class LatencyHistogram {
+    public:
+        void Record(uint64_t nanoseconds) noexcept;
+
+        uint64_t GetCount() const noexcept;
+        uint64_t GetTotal() const noexcept;
+        uint64_t GetMin() const noexcept;
+        uint64_t GetMax() const noexcept;
+        // верхняя граница корзины, в которую попадает перцентиль quantile (от 0 до 1), но не больше максимума
+        uint64_t GetPercentile(double quantile) const noexcept;
+
+    private:
+        static constexpr unsigned SUB_BUCKET_BITS = 5;
+        static constexpr size_t SUB_BUCKET_COUNT = size_t{ 1 } << SUB_BUCKET_BITS;
+        static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+        static size_t GetBucketIndex(uint64_t value) noexcept;
+        static uint64_t GetBucketUpperBound(size_t index) noexcept;
+
+        std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+        std::atomic<uint64_t> count_ = 0;
+        std::atomic<uint64_t> total_ = 0;
+        std::atomic<uint64_t> min_ = UINT64_MAX;
+        std::atomic<uint64_t> max_ = 0;
+    };
+
+    // perf - прирост аппаратных счетчиков за фазу, недоступные счетчики не учитываются
+    void RecordPhase(Phase phase, uint64_t nanoseconds, const PerfSample& perf) noexcept;
+    void RecordRequest(RequestType type, uint64_t nanoseconds) noexcept;
+
+    // работа маршрутизатора при последнем построении таблицы кратчайших путей
+    struct RouterBuildStats {
+        uint64_t vertex_count = 0;
+        uint64_t edge_count = 0;
+        uint64_t relax_checks = 0;
+        uint64_t relax_improvements = 0;
+        uint64_t reachable_pairs = 0;
+    };
+
+    enum class RouteOutcome {
+        FOUND,
+        NOT_FOUND,
+        // начальная и конечная остановки совпадают, таблица не нужна
+        SAME_STOP,
+    };
+
+    void RecordRouterBuild(const RouterBuildStats& build) noexcept;
+    // path_edges - число ребер найденного пути, оно же число шагов восстановления пути по таблице
+    void RecordRouteQuery(RouteOutcome outcome, size_t path_edges) noexcept;
+    // запрос маршрута, повторяющий более ранний в том же пакете: ответ берется готовым, маршрутизатор не вызывается
+    void RecordRouteDuplicate() noexcept;
+
+    // выводит собранную статистику документом JSON: для каждой фазы и каждого типа запроса -
+    // число замеров, суммарное время и перцентили p50, p99, p999 в микросекундах,
+    // а для фаз при включенных счетчиках - их суммы и число инструкций на такт;
+    // в разделе "router" - работа построения маршрутизатора и итоги запросов маршрута
+    void WriteJson(std::ostream& output);
+
+    // замеряет время от создания до уничтожения и записывает его в статистику;
+    // для фазы записывается только собственное время, без вложенных в нее фаз того же потока
+    template <bool Enabled>
+    class BasicScopedTimer {
+    public:
+        explicit BasicScopedTimer(Phase phase) noexcept {
+            static_cast<void>(phase);
+        }
+        explicit BasicScopedTimer(RequestType type) noexcept {
+            static_cast<void>(type);
+        }
+    };
+
+    template <>
+    class BasicScopedTimer<true> {
+    public:
+        explicit BasicScopedTimer(Phase phase) noexcept
+            : is_phase_(true), phase_(phase), parent_(current_phase_), perf_start_(ReadPerfCounters()) {
+            current_phase_ = this;
+            // часы запускаются после чтения счетчиков, чтобы системные вызовы не попадали в замер времени
+            start_ = std::chrono::steady_clock::now();
+        }
+        explicit BasicScopedTimer(RequestType type) noexcept : is_phase_(false), type_(type) {
+        }
+        BasicScopedTimer(const BasicScopedTimer&) = delete;
+        BasicScopedTimer& operator=(const BasicScopedTimer&) = delete;
+
+        ~BasicScopedTimer() {
+            const auto duration = std::chrono::steady_clock::now() - start_;
+            const auto nanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+            if (is_phase_) {
+                const PerfSample perf = GetPerfDelta(perf_start_, ReadPerfCounters());
+                RecordPhase(phase_, nanoseconds - std::min(nested_nanoseconds_, nanoseconds),
+                    has_nested_ ? SubtractPerf(perf, nested_perf_) : perf);
+                current_phase_ = parent_;
+                if (parent_) {
+                    parent_->AddNested(nanoseconds, perf);
+                }
+            }
+            else {
+                RecordRequest(type_, nanoseconds);
+            }
+        }
+
+    private:
+        void AddNested(uint64_t nanoseconds, const PerfSample& perf) noexcept {
+            nested_nanoseconds_ += nanoseconds;
+            nested_perf_ = has_nested_ ? AddPerf(nested_perf_, perf) : perf;
+            has_nested_ = true;
+        }
+
+        // фаза, замер которой сейчас идет в этом потоке
+        static inline thread_local BasicScopedTimer* current_phase_ = nullptr;
+
+        bool is_phase_;
+        Phase phase_ = Phase::LOAD_BASE;
+        RequestType type_ = RequestType::STOP;
+        BasicScopedTimer* parent_ = nullptr;
+        // полное время и прирост счетчиков вложенных фаз
+        uint64_t nested_nanoseconds_ = 0;
+        PerfSample nested_perf_;
+        bool has_nested_ = false;
+        // счетчики читаются только на границах фаз: для отдельного запроса системный вызов дороже самого ответа
+        PerfSample perf_start_;
+        std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+    };
+
+    using ScopedTimer = BasicScopedTimer<ENABLED>;
+
+} // namespace stats
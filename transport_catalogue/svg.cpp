@@ -1,9 +1,191 @@
 
 #include "svg.h"
 
+#include <charconv>
+#include <iterator>
+
 namespace svg {
+    namespace {
+
+        // вывод тегов в поток с его настройками форматирования - для объектов документа
+        struct OstreamSink {
+            std::ostream& out;
+
+            void Write(std::string_view text) {
+                out << text;
+            }
+            template <typename Number>
+            void WriteNumber(Number value) {
+                out << value;
+            }
+        };
+
+        // вывод тегов в строку: числа форматируются std::to_chars так же, как поток с настройками по умолчанию
+        // (как printf("%g") с 6 значащими цифрами), но без локали и виртуальных вызовов потока на каждое число
+        struct StringSink {
+            std::string& buffer;
+
+            void Write(std::string_view text) {
+                buffer.append(text);
+            }
+            void WriteNumber(double value) {
+                char chars[32];
+                const auto result = std::to_chars(std::begin(chars), std::end(chars), value, std::chars_format::general, 6);
+                buffer.append(chars, result.ptr);
+            }
+            void WriteNumber(int value) {
+                char chars[16];
+                const auto result = std::to_chars(std::begin(chars), std::end(chars), value);
+                buffer.append(chars, result.ptr);
+            }
+            void WriteNumber(uint32_t value) {
+                char chars[16];
+                const auto result = std::to_chars(std::begin(chars), std::end(chars), value);
+                buffer.append(chars, result.ptr);
+            }
+        };
+
+        template <typename Sink>
+        void RenderColor(Sink& sink, const Color& color) {
+            if (std::holds_alternative<std::monostate>(color)) {
+                sink.Write("none"sv);
+            }
+            else if (const auto* name = std::get_if<std::string>(&color)) {
+                sink.Write(*name);
+            }
+            else if (const auto* rgb = std::get_if<Rgb>(&color)) {
+                sink.Write("rgb("sv);
+                sink.WriteNumber(int(rgb->red));
+                sink.Write(","sv);
+                sink.WriteNumber(int(rgb->green));
+                sink.Write(","sv);
+                sink.WriteNumber(int(rgb->blue));
+                sink.Write(")"sv);
+            }
+            else if (const auto* rgba = std::get_if<Rgba>(&color)) {
+                sink.Write("rgba("sv);
+                sink.WriteNumber(int(rgba->red));
+                sink.Write(","sv);
+                sink.WriteNumber(int(rgba->green));
+                sink.Write(","sv);
+                sink.WriteNumber(int(rgba->blue));
+                sink.Write(","sv);
+                sink.WriteNumber(rgba->opacity);
+                sink.Write(")"sv);
+            }
+        }
+
+        std::string_view GetLineCapName(StrokeLineCap line_cap) {
+            switch (line_cap) {
+            case StrokeLineCap::BUTT:
+                return "butt"sv;
+            case StrokeLineCap::ROUND:
+                return "round"sv;
+            case StrokeLineCap::SQUARE:
+                return "square"sv;
+            }
+            return {};
+        }
+
+        std::string_view GetLineJoinName(StrokeLineJoin line_join) {
+            switch (line_join) {
+            case StrokeLineJoin::ARCS:
+                return "arcs"sv;
+            case StrokeLineJoin::BEVEL:
+                return "bevel"sv;
+            case StrokeLineJoin::MITER:
+                return "miter"sv;
+            case StrokeLineJoin::MITER_CLIP:
+                return "miter-clip"sv;
+            case StrokeLineJoin::ROUND:
+                return "round"sv;
+            }
+            return {};
+        }
+
+        template <typename Sink>
+        void RenderPathAttrsTo(Sink& sink, const PathStyle& style) {
+            if (style.fill_color) {
+                sink.Write(" fill=\""sv);
+                RenderColor(sink, *style.fill_color);
+                sink.Write("\""sv);
+            }
+            if (style.stroke_color) {
+                sink.Write(" stroke=\""sv);
+                RenderColor(sink, *style.stroke_color);
+                sink.Write("\""sv);
+            }
+            if (style.stroke_width) {
+                sink.Write(" stroke-width=\""sv);
+                sink.WriteNumber(*style.stroke_width);
+                sink.Write("\""sv);
+            }
+            if (style.line_cap) {
+                sink.Write(" stroke-linecap=\""sv);
+                sink.Write(GetLineCapName(*style.line_cap));
+                sink.Write("\""sv);
+            }
+            if (style.line_join) {
+                sink.Write(" stroke-linejoin=\""sv);
+                sink.Write(GetLineJoinName(*style.line_join));
+                sink.Write("\""sv);
+            }
+        }
+
+        template <typename Sink>
+        void RenderPoint(Sink& sink, Point point) {
+            sink.WriteNumber(point.x);
+            sink.Write(","sv);
+            sink.WriteNumber(point.y);
+        }
+
+        template <typename Sink>
+        void RenderCircleTag(Sink& sink, Point center, double radius, const PathStyle& style) {
+            sink.Write("<circle cx=\""sv);
+            sink.WriteNumber(center.x);
+            sink.Write("\" cy=\""sv);
+            sink.WriteNumber(center.y);
+            sink.Write("\" r=\""sv);
+            sink.WriteNumber(radius);
+            sink.Write("\""sv);
+            RenderPathAttrsTo(sink, style);
+            sink.Write("/>"sv);
+        }
+
+        template <typename Sink>
+        void RenderTextTag(Sink& sink, Point position, std::string_view data, const TextStyle& style) {
+            sink.Write("<text"sv);
+            RenderPathAttrsTo(sink, style.path);
+            sink.Write(" x=\""sv);
+            sink.WriteNumber(position.x);
+            sink.Write("\" y=\""sv);
+            sink.WriteNumber(position.y);
+            sink.Write("\" dx=\""sv);
+            sink.WriteNumber(style.offset.x);
+            sink.Write("\" dy=\""sv);
+            sink.WriteNumber(style.offset.y);
+            sink.Write("\" font-size=\""sv);
+            sink.WriteNumber(style.font_size);
+            sink.Write("\""sv);
+            if (!style.font_family.empty()) {
+                sink.Write(" font-family=\""sv);
+                sink.Write(style.font_family);
+                sink.Write("\""sv);
+            }
+            if (!style.font_weight.empty()) {
+                sink.Write(" font-weight=\""sv);
+                sink.Write(style.font_weight);
+                sink.Write("\""sv);
+            }
+            sink.Write(">"sv);
+            sink.Write(data);
+            sink.Write("</text>"sv);
+        }
+
+    } // namespace
+
     //---------------------------Color------------------------
-    std::ostream& operator<<(std::ostream& out, Color color) {
+    std::ostream& operator<<(std::ostream& out, const Color& color) {
         std::visit(OstreamColorPrinter{ out }, color);
         return out;
     }
@@ -11,7 +193,7 @@ namespace svg {
     void OstreamColorPrinter::operator()(std::monostate) const {
         out << "none";
     }
-    void OstreamColorPrinter::operator()(std::string color) const {
+    void OstreamColorPrinter::operator()(const std::string& color) const {
         out << color;
     }
     void OstreamColorPrinter::operator()(Rgb color) const {
@@ -22,6 +204,12 @@ namespace svg {
         out << "rgba(" << int(color.red) << "," << int(color.green)
             << "," << int(color.blue) << "," << color.opacity << ")";
     }
+    //------------------------PathStyle------------------------
+    void RenderPathAttrs(std::ostream& out, const PathStyle& style) {
+        OstreamSink sink{ out };
+        RenderPathAttrsTo(sink, style);
+    }
+
     //------------------------Object------------------------
     void Object::Render(const RenderContext& context) const {
         context.RenderIndent();
@@ -40,11 +228,8 @@ namespace svg {
         return *this;
     }
     void Circle::RenderObject(const RenderContext& context) const {
-        auto& out = context.out;
-        out << "<circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\" "sv;
-        out << "r=\""sv << radius_ << "\""sv;
-        RenderAttrs(out);
-        out << "/>"sv;
+        OstreamSink sink{ context.out };
+        RenderCircleTag(sink, center_, radius_, GetStyle());
     }
 
     //------------------------Polyline------------------------
@@ -105,23 +290,8 @@ namespace svg {
         return *this;
     }
     void Text::RenderObject(const RenderContext& context) const {
-        auto& out = context.out;
-        out << "<text";
-        RenderAttrs(out);
-        out << " x=\"" << position_.x << "\" y=\"" << position_.y;
-        out << "\" dx=\"" << offset_.x << "\" dy=\"" << offset_.y;
-        out << "\" font-size=\"" << size_ << "\"";
-        if (!font_family_.empty()) {
-            out << " font-family=\"" << font_family_ << "\"";
-        }
-        if (!font_weight_.empty()) {
-            out << " font-weight=\"" << font_weight_ << "\"";
-        }
-        out << ">";
-        if (!data_.empty()) {
-            out << data_;
-        }
-        out << "</text>";
+        OstreamSink sink{ context.out };
+        RenderTextTag(sink, position_, data_, { GetStyle(), offset_, size_, font_family_, font_weight_ });
     }
 
     //----------------------Document------------------
@@ -134,6 +304,73 @@ namespace svg {
         }
         out << "</svg>";
     }
+
+    //----------------------StreamWriter------------------
+    // каждый тег выводится с тем же отступом и переводом строки, что и в Document::Render
+    StreamWriter::StreamWriter(std::ostream& out) : out_(out) {
+        buffer_.reserve(FLUSH_THRESHOLD + FLUSH_THRESHOLD / 4);
+        buffer_ += "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+        buffer_ += "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"sv;
+    }
+
+    StreamWriter::~StreamWriter() {
+        Flush();
+    }
+
+    void StreamWriter::AddCircle(Point center, double radius, const PathStyle& style) {
+        StringSink sink{ buffer_ };
+        sink.Write("  "sv);
+        RenderCircleTag(sink, center, radius, style);
+        sink.Write("\n"sv);
+        FlushIfFull();
+    }
+
+    void StreamWriter::BeginPolyline() {
+        buffer_ += "  <polyline points=\""sv;
+        is_first_point_ = true;
+    }
+
+    void StreamWriter::AddPolylinePoint(Point point) {
+        StringSink sink{ buffer_ };
+        if (!is_first_point_) {
+            sink.Write(" "sv);
+        }
+        RenderPoint(sink, point);
+        is_first_point_ = false;
+        FlushIfFull();
+    }
+
+    void StreamWriter::EndPolyline(const PathStyle& style) {
+        StringSink sink{ buffer_ };
+        sink.Write("\""sv);
+        RenderPathAttrsTo(sink, style);
+        sink.Write("/>\n"sv);
+        FlushIfFull();
+    }
+
+    void StreamWriter::AddText(Point position, std::string_view data, const TextStyle& style) {
+        StringSink sink{ buffer_ };
+        sink.Write("  "sv);
+        RenderTextTag(sink, position, data, style);
+        sink.Write("\n"sv);
+        FlushIfFull();
+    }
+
+    void StreamWriter::Finish() {
+        buffer_ += "</svg>"sv;
+        Flush();
+    }
+
+    void StreamWriter::FlushIfFull() {
+        if (buffer_.size() >= FLUSH_THRESHOLD) {
+            Flush();
+        }
+    }
+
+    void StreamWriter::Flush() {
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
 }
 
 svg::Polyline CreateStar(svg::Point center, double outer_rad, double inner_rad, int num_rays) {
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <deque>
 #include <variant>
@@ -33,11 +34,11 @@ namespace svg {
     struct OstreamColorPrinter {
         std::ostream& out;
         void operator()(std::monostate) const;
-        void operator()(std::string) const;
+        void operator()(const std::string& color) const;
         void operator()(Rgb) const;
         void operator()(Rgba) const;
     };
-    std::ostream& operator<<(std::ostream& out, Color color);
+    std::ostream& operator<<(std::ostream& out, const Color& color);
 
     enum class StrokeLineCap {
         BUTT,
@@ -52,6 +53,19 @@ namespace svg {
         MITER_CLIP,
         ROUND,
     };
+
+    // оформление контура без копирования цветов: nullptr или пустой optional - атрибут не выводится
+    struct PathStyle {
+        const Color* fill_color = nullptr;
+        const Color* stroke_color = nullptr;
+        std::optional<double> stroke_width;
+        std::optional<StrokeLineCap> line_cap;
+        std::optional<StrokeLineJoin> line_join;
+    };
+
+    // выводит атрибуты fill, stroke, stroke-width, stroke-linecap и stroke-linejoin
+    void RenderPathAttrs(std::ostream& out, const PathStyle& style);
+
     template <typename Path>
     class PathProps {
     public:
@@ -81,48 +95,12 @@ namespace svg {
         std::optional <double> stroke_width_;
         std::optional <StrokeLineCap> line_cap_;
         std::optional <StrokeLineJoin> line_join_;
+        PathStyle GetStyle() const {
+            return { fill_color_ ? &*fill_color_ : nullptr, stroke_color_ ? &*stroke_color_ : nullptr,
+                stroke_width_, line_cap_, line_join_ };
+        }
         void RenderAttrs(std::ostream& out) const {
-            if (fill_color_) {
-                out << " fill=\"" << *fill_color_ << "\"";
-            }
-
-            if (stroke_color_) {
-                out << " stroke=\"" << *stroke_color_ << "\"";
-            }
-
-            if (stroke_width_) {
-                out << " stroke-width=\"" << *stroke_width_ << "\"";
-            }
-
-            if (line_cap_) {
-                if (*line_cap_ == StrokeLineCap::BUTT) {
-                    out << " stroke-linecap=\"" << "butt" << "\"";
-                }
-                else if (*line_cap_ == StrokeLineCap::ROUND) {
-                    out << " stroke-linecap=\"" << "round" << "\"";
-                }
-                else if (*line_cap_ == StrokeLineCap::SQUARE) {
-                    out << " stroke-linecap=\"" << "square" << "\"";
-                }
-            }
-
-            if (line_join_) {
-                if (*line_join_ == StrokeLineJoin::ARCS) {
-                    out << " stroke-linejoin=\"" << "arcs" << "\"";
-                }
-                else if (*line_join_ == StrokeLineJoin::BEVEL) {
-                    out << " stroke-linejoin=\"" << "bevel" << "\"";
-                }
-                else if (*line_join_ == StrokeLineJoin::MITER) {
-                    out << " stroke-linejoin=\"" << "miter" << "\"";
-                }
-                else if (*line_join_ == StrokeLineJoin::MITER_CLIP) {
-                    out << " stroke-linejoin=\"" << "miter-clip" << "\"";
-                }
-                else if (*line_join_ == StrokeLineJoin::ROUND) {
-                    out << " stroke-linejoin=\"" << "round" << "\"";
-                }
-            }
+            RenderPathAttrs(out, GetStyle());
         }
 
     private:
@@ -245,6 +223,51 @@ namespace svg {
         // Прочие методы и данные, необходимые для реализации класса Document 
     };
 
+    // оформление текста, строки не копируются и должны жить до вывода
+    struct TextStyle {
+        PathStyle path;
+        Point offset;
+        uint32_t font_size = 1;
+        std::string_view font_family;
+        std::string_view font_weight;
+    };
+
+    // Потоковый вывод SVG: теги пишутся по мере вызовов, объекты документа не создаются
+    // теги копятся в собственном буфере и отдаются в поток крупными блоками; числа выводятся
+    // как потоком с настройками по умолчанию, поэтому для тех же фигур в том же порядке
+    // вывод совпадает с Document::Render в такой поток
+    class StreamWriter {
+    public:
+        // начинает документ с заголовка
+        explicit StreamWriter(std::ostream& out);
+        // отдает в поток то, что ещё не выведено; незакрытый документ остается незакрытым
+        ~StreamWriter();
+        StreamWriter(const StreamWriter&) = delete;
+        StreamWriter& operator=(const StreamWriter&) = delete;
+
+        void AddCircle(Point center, double radius, const PathStyle& style);
+
+        // ломаная выводится по мере добавления вершин, между BeginPolyline и EndPolyline
+        void BeginPolyline();
+        void AddPolylinePoint(Point point);
+        void EndPolyline(const PathStyle& style);
+
+        void AddText(Point position, std::string_view data, const TextStyle& style);
+
+        // закрывает документ и отдает остаток буфера в поток, после этого писать в него нельзя
+        void Finish();
+
+    private:
+        static constexpr size_t FLUSH_THRESHOLD = 64 * 1024;
+
+        void FlushIfFull();
+        void Flush();
+
+        std::ostream& out_;
+        std::string buffer_;
+        bool is_first_point_ = true;
+    };
+
     class Drawable {
     public:
         virtual void Draw(ObjectContainer& container) const = 0;
@@ -26,13 +26,15 @@ namespace detail_transport_catalogue {
 	}
 
 	// считает расстояние по маршруту по прямой между координатами остановок
+	template <typename DistancePolicy>
 	double CalculateRouteLength(const Route* route) noexcept {
 		double result = 0.0;
-		if (route != nullptr) {
-			for (auto iter1 = route->stops.begin(), iter2 = iter1 + 1;
-				iter2 < route->stops.end();
-				++iter1, ++iter2) {
-				result += ComputeDistance((*iter1)->coordinate, (*iter2)->coordinate);
+		if (route != nullptr && route->stops.size() > 1) {
+			// синусы и косинусы широт посчитаны при добавлении остановок, на каждую пару остается одна тригонометрия
+			for (size_t i = 0; i + 1 < route->stops.size(); ++i) {
+				const Stop* from = route->stops[i];
+				const Stop* to = route->stops[i + 1];
+				result += DistancePolicy::Distance(from->coordinate, from->trig, to->coordinate, to->trig);
 			}
 			if (route->route_type == RouteType::LINEAR) {
 				result *= 2;
@@ -40,6 +42,8 @@ namespace detail_transport_catalogue {
 		}
 		return result;
 	}
+
+	template double CalculateRouteLength<geo_distance::SphericalCosines>(const Route* route) noexcept;
 }//detail_transport_catalogue
 
 namespace transport_catalogue {
@@ -47,8 +51,15 @@ namespace transport_catalogue {
 		Stop stop;
 		stop.name = stop_name;
 		stop.coordinate = coordinate;
+		stop.trig = ComputeLatitudeTrig(coordinate.lat);
+		stop.id = stops_.size();
 		stops_.push_back(stop);
 		stops_by_names_.insert({ stops_.back().name, &stops_.back() });
+		stop_coordinates_.lat.push_back(coordinate.lat);
+		stop_coordinates_.lng.push_back(coordinate.lng);
+		stop_coordinates_.on_route.push_back(0);
+		++version_;
+		++routing_version_;
 	}
 
 	void TransportCatalogue::AddRoute(const std::string& route_name, RouteType route_type, const std::vector<std::string>& stops) {
@@ -63,8 +74,68 @@ namespace transport_catalogue {
 		std::string_view route_name_add = routes_.back().name;
 		routes_by_names_.insert({ route_name_add, &routes_.back() });
 		// добавляем информацию об автобусе в остановки по маршруту
-		for (auto stop : routes_.back().stops) {
-			buses_on_stops_[stop->name].insert(route_name_add);
+		LinkRouteStops(routes_.back());
+		++version_;
+		++routing_version_;
+		++geometry_version_;
+	}
+
+	void TransportCatalogue::RemoveRoute(const std::string& route_name) {
+		auto route = FindRoute(route_name);
+		// сам маршрут остается в deque, чтобы не инвалидировать указатели и string_view на его имя
+		UnlinkRouteStops(*route);
+		route_infos_.erase(route->name);
+		routes_by_names_.erase(route->name);
+		++version_;
+		++routing_version_;
+		++geometry_version_;
+	}
+
+	void TransportCatalogue::UpdateRoute(const std::string& route_name, RouteType route_type, const std::vector<std::string>& stops) {
+		auto route = const_cast<Route*>(FindRoute(route_name));
+		// сначала находим все остановки, чтобы при ошибке маршрут остался прежним
+		std::vector<const Stop*> new_stops;
+		new_stops.reserve(stops.size());
+		for (auto& stop_name : stops) {
+			new_stops.push_back(FindStop(stop_name));
+		}
+		UnlinkRouteStops(*route);
+		route->route_type = route_type;
+		route->stops = std::move(new_stops);
+		LinkRouteStops(*route);
+		route_infos_.erase(route->name);
+		++version_;
+		++routing_version_;
+		++geometry_version_;
+	}
+
+	void TransportCatalogue::RemoveStop(const std::string& stop_name) {
+		auto stop = FindStop(stop_name);
+		if (buses_on_stops_.count(stop->name) != 0) {
+			throw std::logic_error("Stop "s + stop_name + " is used by routes"s);
+		}
+		// удаляем расстояния от остановки и до неё
+		distances_.erase(stop->name);
+		for (auto& [from, distances_from] : distances_) {
+			distances_from.erase(stop->name);
+		}
+		// сама остановка остается в deque, чтобы не инвалидировать указатели и string_view на её имя
+		stops_by_names_.erase(stop->name);
+		++version_;
+		++routing_version_;
+	}
+
+	void TransportCatalogue::MoveStop(const std::string& stop_name, Coordinates coordinate) {
+		auto stop = const_cast<Stop*>(FindStop(stop_name));
+		stop->coordinate = coordinate;
+		stop->trig = ComputeLatitudeTrig(coordinate.lat);
+		stop_coordinates_.lat[stop->id] = coordinate.lat;
+		stop_coordinates_.lng[stop->id] = coordinate.lng;
+		// координаты не влияют на граф маршрутизации, только на кривизну и карту
+		InvalidateRoutesOnStop(stop->name);
+		++version_;
+		if (buses_on_stops_.count(stop->name) != 0) {
+			++geometry_version_;
 		}
 	}
 
@@ -83,17 +154,27 @@ namespace transport_catalogue {
 	}
 
 	RouteInfo TransportCatalogue::GetRouteInfo(const std::string& route_name) const {
-		RouteInfo result;
 		auto route = FindRoute(route_name);
+		if (auto it = route_infos_.find(route->name); it != route_infos_.end()) {
+			return it->second;
+		}
+		RouteInfo result;
 		result.name = route->name;
 		result.route_type = route->route_type;
 		result.num_of_stops = detail_transport_catalogue::CalculateStops(route);
 		result.num_of_unique_stops = detail_transport_catalogue::CalculateUniqueStops(route);
 		result.route_length = CalculateRealRouteLength(route);
 		result.curvature = result.route_length / detail_transport_catalogue::CalculateRouteLength(route);
+		route_infos_.insert({ route->name, result });
 		return result;
 	}
 
+	void TransportCatalogue::PrecomputeRouteInfos() const {
+		for (const auto& [name, route] : routes_by_names_) {
+			GetRouteInfo(route->name);
+		}
+	}
+
 	std::set<std::string_view> TransportCatalogue::GetBusesOnStop(const std::string& stop_name) const {
 		if (stops_by_names_.count(stop_name) == 0) {
 			throw std::out_of_range("Stop "s + stop_name + " does not exist in catalogue"s);
@@ -136,6 +217,15 @@ namespace transport_catalogue {
 		auto Stop_from = FindStop(stop_from);
 		auto Stop_to = FindStop(stop_to);
 		distances_[Stop_from->name][Stop_to->name] = distance;
+		// расстояние от остановки используется только маршрутами, проходящими через неё
+		InvalidateRoutesOnStop(Stop_from->name);
+		++version_;
+		++routing_version_;
+	}
+
+	void TransportCatalogue::UpdateDistance(const std::string& stop_from, const std::string& stop_to, int distance) {
+		GetForwardDistance(stop_from, stop_to);
+		SetDistance(stop_from, stop_to, distance);
 	}
 
 	int TransportCatalogue::CalculateRealRouteLength(const Route* route) const {
@@ -173,4 +263,53 @@ namespace transport_catalogue {
 		& TransportCatalogue::GetBusesOnStops() const {
 		return buses_on_stops_;
 	}
+
+	const StopCoordinates& TransportCatalogue::GetStopCoordinates() const {
+		return stop_coordinates_;
+	}
+
+	uint64_t TransportCatalogue::GetVersion() const {
+		return version_;
+	}
+
+	uint64_t TransportCatalogue::GetRoutingVersion() const {
+		return routing_version_;
+	}
+
+	uint64_t TransportCatalogue::GetGeometryVersion() const {
+		return geometry_version_;
+	}
+
+	void TransportCatalogue::UnlinkRouteStops(const Route& route) {
+		for (auto stop : route.stops) {
+			auto it = buses_on_stops_.find(stop->name);
+			if (it == buses_on_stops_.end()) {
+				continue;
+			}
+			it->second.erase(route.name);
+			// в индексе остаются только остановки, через которые проходит хотя бы один автобус
+			if (it->second.empty()) {
+				buses_on_stops_.erase(it);
+				stop_coordinates_.on_route[stop->id] = 0;
+			}
+		}
+	}
+
+	void TransportCatalogue::LinkRouteStops(const Route& route) {
+		for (auto stop : route.stops) {
+			buses_on_stops_[stop->name].insert(route.name);
+			stop_coordinates_.on_route[stop->id] = 1;
+		}
+	}
+
+	void TransportCatalogue::InvalidateRoutesOnStop(std::string_view stop_name) {
+		if (route_infos_.empty()) {
+			return;
+		}
+		if (auto it = buses_on_stops_.find(stop_name); it != buses_on_stops_.end()) {
+			for (auto route_name : it->second) {
+				route_infos_.erase(route_name);
+			}
+		}
+	}
 }//transport_catalogue
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <deque>
+#include <vector>
 #include <string>
 #include <unordered_map>
 #include <string_view>
@@ -8,6 +9,7 @@
 #include <functional>
 #include <utility>
 #include <unordered_set>
+#include <cstdint>
 #include "geo.h"
 using namespace std::literals;
 
@@ -32,11 +34,31 @@ struct RouteInfo {
 struct Stop {
 	std::string name;
 	Coordinates coordinate;
+	// синус и косинус широты, считаются при добавлении остановки
+	LatitudeTrig trig;
+	// порядковый номер остановки в каталоге, индекс в StopCoordinates
+	size_t id = 0;
 	friend bool operator==(const Stop& lhs, const Stop& rhs) {
 		return (lhs.name == rhs.name && lhs.coordinate == rhs.coordinate);
 	}
 };
 
+// координаты всех остановок каталога в виде структуры массивов, индекс - Stop::id
+// для последовательного просмотра координат (границы карты, проекция, пространственные индексы)
+// без подтягивания в кэш имен остановок
+struct StopCoordinates {
+	std::vector<double> lat;
+	std::vector<double> lng;
+	// 1 - через остановку проходит хотя бы один маршрут
+	// удалить можно только остановку без маршрутов, поэтому у удаленных остановок здесь всегда 0
+	// и просмотр по on_route их пропускает
+	std::vector<uint8_t> on_route;
+
+	size_t Size() const noexcept {
+		return lat.size();
+	}
+};
+
 //Маршрут состоит из номера автобуса,типа и списка остановок
 struct Route {
 	std::string name;
@@ -54,6 +76,9 @@ namespace detail_transport_catalogue {
 	int CalculateUniqueStops(const Route* route) noexcept;
 
 	// считает расстояние по маршруту по прямой между координатами остановок
+	// способ расчета расстояния задается политикой из geo_distance; кривизна считается точной SphericalCosines,
+	// только для неё функция и инстанцирована
+	template <typename DistancePolicy = geo_distance::SphericalCosines>
 	double CalculateRouteLength(const Route* route) noexcept;
 }
 
@@ -66,6 +91,23 @@ namespace transport_catalogue {
 		// формирует маршрут из списка остановок и добавляет его в каталог.
 		void AddRoute(const std::string& route_name, RouteType route_type, const std::vector<std::string>& stops);
 
+		// удаляет маршрут из каталога
+		// если маршрута нет в каталоге - выбрасывает исключение
+		void RemoveRoute(const std::string& route_name);
+
+		// заменяет тип и список остановок существующего маршрута
+		// если маршрута или какой-то из остановок нет в каталоге - выбрасывает исключение
+		void UpdateRoute(const std::string& route_name, RouteType route_type, const std::vector<std::string>& stops);
+
+		// удаляет остановку и все расстояния от неё и до неё
+		// если остановки нет в каталоге - выбрасывает исключение
+		// если через остановку проходит маршрут - выбрасывает исключение std::logic_error
+		void RemoveStop(const std::string& stop_name);
+
+		// меняет координаты остановки
+		// если остановки нет в каталоге - выбрасывает исключение
+		void MoveStop(const std::string& stop_name, Coordinates coordinate);
+
 		// возвращает указатель на остановку по её имени
 		// если остановки нет в каталоге - выбрасывает исключение
 		const Stop* FindStop(const std::string& stop_name) const;
@@ -78,6 +120,10 @@ namespace transport_catalogue {
 		// если маршрута нет в каталоге - выбрасывает исключение std::out_of_range
 		RouteInfo GetRouteInfo(const std::string& route_name) const;
 
+		// заранее считает информацию обо всех маршрутах: после этого GetRouteInfo только читает кэш
+		// и её можно вызывать из нескольких потоков, пока каталог не изменяется
+		void PrecomputeRouteInfos() const;
+
 		// возвращает список автобусов, проходящих через остановку
 		// если остановки нет в каталоге - выбрасывает исключение std::out_of_range
 		std::set<std::string_view> GetBusesOnStop(const std::string& stop_name) const;
@@ -94,6 +140,10 @@ namespace transport_catalogue {
 		// если какой-то из остановок нет в каталоге - выбрасывает исключение
 		void SetDistance(const std::string& stop_from, const std::string& stop_to, int distance);
 
+		// меняет уже известное расстояние от остановки 1 до остановки 2
+		// если информации о расстоянии нет в каталоге - выбрасывает исключение std::out_of_range
+		void UpdateDistance(const std::string& stop_from, const std::string& stop_to, int distance);
+
 		// считает общее расстояние по маршруту
 		// если нет информации о расстоянии между какой-либо парой соседних остановок - выбросит исключение
 		int CalculateRealRouteLength(const Route* route) const;
@@ -103,11 +153,23 @@ namespace transport_catalogue {
 		// возвращает ссылку на остановки в каталоге
 		const std::unordered_map<std::string_view, const Stop*>& GetStops() const;
 		const std::unordered_map<std::string_view, std::set<std::string_view>>& GetBusesOnStops() const;
+		// возвращает координаты остановок в виде структуры массивов
+		const StopCoordinates& GetStopCoordinates() const;
+
+		// счётчики изменений каталога, по ним зависимые структуры понимают, что их данные устарели
+		// любое изменение каталога
+		uint64_t GetVersion() const;
+		// изменения, влияющие на граф маршрутизации (состав остановок, маршруты, расстояния)
+		uint64_t GetRoutingVersion() const;
+		// изменения, влияющие на отрисовку карты (маршруты, координаты остановок)
+		uint64_t GetGeometryVersion() const;
 
 	private:
 		// остановки
 		std::deque<Stop> stops_;
 		std::unordered_map<std::string_view, const Stop*> stops_by_names_;
+		// копия координат остановок в виде структуры массивов
+		StopCoordinates stop_coordinates_;
 		// автобусы на каждой остановке
 		std::unordered_map<std::string_view, std::set<std::string_view>> buses_on_stops_;
 		// маршруты
@@ -115,6 +177,18 @@ namespace transport_catalogue {
 		std::unordered_map<std::string_view, const Route*> routes_by_names_;
 		// расстояния между остановками
 		std::unordered_map<std::string_view, std::unordered_map<std::string_view, int>> distances_;
+		// посчитанная информация о маршрутах, сбрасывается только для затронутых изменением маршрутов
+		mutable std::unordered_map<std::string_view, RouteInfo> route_infos_;
+
+		uint64_t version_ = 0;
+		uint64_t routing_version_ = 0;
+		uint64_t geometry_version_ = 0;
+
+		// удаляет/добавляет автобус в списки автобусов на остановках маршрута
+		void UnlinkRouteStops(const Route& route);
+		void LinkRouteStops(const Route& route);
+		// сбрасывает посчитанную информацию о маршрутах, проходящих через остановку
+		void InvalidateRoutesOnStop(std::string_view stop_name);
 	};
 }//transport_catalogue
 
@@ -6,21 +6,43 @@ namespace transport_router {
     }
 
     void TransportRouter::InitRouter() {
+        // если граф построен по устаревшим данным каталога - строим его заново
+        if (is_initialized_ && routing_version_ != catalogue_.GetRoutingVersion()) {
+            ResetRouter();
+        }
         // если роутер ещё не был инициализирован - делаем это
         if (!is_initialized_) {
+            [[maybe_unused]] stats::ScopedTimer timer(stats::Phase::INIT_ROUTER);
+            routing_version_ = catalogue_.GetRoutingVersion();
             graph::DirectedWeightedGraph<RouteWeight>graph(CountStops());
             graph_ = std::move(graph);
             // записываем маршруты в граф
             BuildEdges();
             // строим маршрутизатор
-            router_ = std::make_unique<graph::Router<RouteWeight>>(graph_);
+            router_ = std::make_unique<Router>(graph_);
             is_initialized_ = true;
+            if constexpr (stats::ENABLED) {
+                const auto& build = router_->GetBuildStats();
+                stats::RecordRouterBuild({ build.vertex_count, build.edge_count, build.relax_checks,
+                    build.relax_improvements, build.reachable_pairs });
+            }
         }
     }
 
+    void TransportRouter::ResetRouter() {
+        router_.reset();
+        graph_ = Graph{};
+        stops_by_id_.clear();
+        id_by_stop_name_.clear();
+        is_initialized_ = false;
+    }
+
     std::optional<TransportRouter::TransportRoute> TransportRouter::BuildRoute(const std::string& from, const std::string& to) {
         // если начальная и конечная остановка одинаковые - возвращаем пустой результат
         if (from == to) {
+            if constexpr (stats::ENABLED) {
+                stats::RecordRouteQuery(stats::RouteOutcome::SAME_STOP, 0);
+            }
             return TransportRoute{};
         }
         InitRouter();
@@ -28,8 +50,14 @@ namespace transport_router {
         auto to_id = id_by_stop_name_.at(to);
         auto route = router_->BuildRoute(from_id, to_id);
         if (!route) {
+            if constexpr (stats::ENABLED) {
+                stats::RecordRouteQuery(stats::RouteOutcome::NOT_FOUND, 0);
+            }
             return std::nullopt;
         }
+        if constexpr (stats::ENABLED) {
+            stats::RecordRouteQuery(stats::RouteOutcome::FOUND, route->edges.size());
+        }
 
         TransportRoute result;
         // проходим по всем ребрам маршрута
@@ -55,6 +83,7 @@ namespace transport_router {
     }
 
     void TransportRouter::InternalInit() {
+        routing_version_ = catalogue_.GetRoutingVersion();
         is_initialized_ = true;
     }
 
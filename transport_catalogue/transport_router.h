@@ -2,6 +2,7 @@
 
 #include "graph.h"
 #include "router.h"
+#include "stats.h"
 #include "transport_catalogue.h"
 
 #include <memory>
@@ -33,7 +34,8 @@ namespace transport_router {
         using Graph = graph::DirectedWeightedGraph<RouteWeight>;
         using StopsById = std::unordered_map<size_t, const Stop*>;
         using IdsByStopName = std::unordered_map<std::string_view, size_t>;
-        using Router = graph::Router<RouteWeight>;
+        // при сборке со статистикой маршрутизатор считает проделанную работу
+        using Router = graph::Router<RouteWeight, stats::ENABLED>;
 
         struct RoutingSettings {
             int wait_time = 0;      // в минутах
@@ -57,7 +59,10 @@ namespace transport_router {
         RoutingSettings& GetSettings();
 
         // ленивая инициализация по данным каталога (запускается при первом запросе маршрута, либо вручную)
+        // если маршрутизирующие данные каталога изменились с момента построения - граф строится заново
         void InitRouter();
+        // сбрасывает построенный граф, он будет перестроен при следующем запросе маршрута
+        void ResetRouter();
         // инициализирует маршрутизатор внутренними данными, загруженными вручную
         // при неправильно инициализированных внутренних данных корректность работы не гарантируется
         void InternalInit();
@@ -78,6 +83,8 @@ namespace transport_router {
     private:
 
         bool is_initialized_ = false;
+        // версия маршрутизирующих данных каталога, по которой построен граф
+        uint64_t routing_version_ = 0;
 
         const transport_catalogue::TransportCatalogue& catalogue_;
         RoutingSettings settings_;